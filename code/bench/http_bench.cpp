@@ -0,0 +1,880 @@
+//
+// HTTP 压测工具：每个线程一个 epoll，管理若干非阻塞连接
+// 闭环模式下每个连接保持 depth 个在途请求；定速模式（-r）按固定间隔排定请求，
+// 延迟从排定时间算起，服务端变慢时请求在客户端排队的时间也计入（修正协调遗漏）
+// 用法：bench [-a 地址] [-p 端口] [-t 线程数] [-c 连接数] [-d 测量秒数] [-w 预热秒数]
+//            [-r 总速率] [-P 流水线深度] [-k 1|0] [-m index=70,image=20,login=8,register=2] [-o 输出文件]
+// 结果以 JSON 输出到标准输出（或 -o 指定的文件）
+//
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <cerrno>
+#include <cmath>
+#include <cstdint>
+#include <chrono>
+#include <thread>
+#include <vector>
+#include <deque>
+#include <string>
+#include <memory>
+#include <algorithm>
+#include <unistd.h>
+#include <strings.h>
+#include <getopt.h>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/socket.h>
+#include <sys/epoll.h>
+#include <sys/timerfd.h>
+
+namespace
+{
+    enum SCENARIO
+    {
+        INDEX = 0, // 首页，小静态文件
+        IMAGE,     // 约 100KB 的图片
+        LOGIN,     // 登录 POST，走数据库通道
+        REGISTER,  // 注册 POST，每次用新用户名
+        SCENARIO_COUNT,
+    };
+    const char *SCENARIO_NAME[SCENARIO_COUNT] = {"index", "image", "login", "register"};
+
+    const int64_t NS_PER_SEC = 1000000000;
+    const int64_t DRAIN_NS = 2 * NS_PER_SEC;     // 结束后等待在途请求的时间
+    const int64_t RECONNECT_NS = NS_PER_SEC / 10; // 连接失败后重试的间隔
+    const size_t MAX_HEAD = 16 * 1024;
+
+    struct Options
+    {
+        std::string host = "127.0.0.1";
+        int port = 8080;
+        int threads = 2;
+        int connections = 32;
+        double duration = 10;
+        double warmup = 1;
+        double rate = 0; // 所有线程合计的请求速率，0 为闭环
+        int depth = 1;
+        bool keepAlive = true;
+        int weights[SCENARIO_COUNT] = {100, 0, 0, 0};
+        std::string output;
+    };
+
+    int64_t NowNs()
+    {
+        return std::chrono::duration_cast<std::chrono::nanoseconds>(
+                   std::chrono::steady_clock::now().time_since_epoch())
+            .count();
+    }
+
+    struct Pending
+    {
+        int scenario;
+        int64_t intendedNs; // 排定时间；闭环时与发出时间相同
+        int64_t sentNs;
+    };
+
+    struct Conn
+    {
+        int fd = -1;
+        bool connecting = false;
+        uint32_t events = 0;
+        int64_t retryNs = 0;
+        std::string out;
+        size_t outPos = 0;
+        std::deque<Pending> inflight;
+        // 响应解析状态
+        std::string head;
+        bool inBody = false;
+        int64_t bodyLeft = 0;
+        int status = 0;
+        bool closeAfter = false;
+    };
+
+    struct Stats
+    {
+        std::vector<uint32_t> latencyUs[SCENARIO_COUNT]; // 从排定时间到收完响应
+        std::vector<uint32_t> serviceUs[SCENARIO_COUNT]; // 从实际发出到收完响应
+        uint64_t status[6] = {0};                        // 1xx~5xx、其他
+        uint64_t bytes = 0;
+        uint64_t errors = 0;        // 连接断开时仍在途的请求
+        uint64_t connectErrors = 0;
+        uint64_t connects = 0;
+        uint64_t timeouts = 0;      // 收尾时仍未完成的请求
+        uint64_t unsent = 0;        // 定速模式下到结束仍排队未发出的请求
+    };
+
+    class Worker
+    {
+    public:
+        Worker(const Options &opt, int id, int conns, double rate)
+            : opt_(opt), id_(id), conns_(conns), interval_(rate > 0 ? static_cast<int64_t>(NS_PER_SEC / rate) : 0),
+              epollFd_(-1), timerFd_(-1), seed_(0x9E3779B97F4A7C15ULL ^ (static_cast<uint64_t>(id) << 32)),
+              regSeq_(0), cursor_(0), nextNs_(0), startNs_(0), measureNs_(0), endNs_(0)
+        {
+            totalWeight_ = 0;
+            for (int w : opt_.weights)
+            {
+                totalWeight_ += w;
+            }
+        }
+
+        void Run(int64_t startNs, int64_t measureNs, int64_t endNs);
+        Stats stats;
+
+    private:
+        void Connect_(Conn &c, int64_t now);
+        void Close_(Conn &c, int64_t now);
+        void Update_(Conn &c);
+        void Send_(Conn &c, int scenario, int64_t intendedNs, int64_t now);
+        bool Flush_(Conn &c);
+        bool Read_(Conn &c, int64_t now);
+        bool Consume_(Conn &c, const char *data, size_t len, int64_t now);
+        bool ParseHead_(Conn &c, size_t end);
+        bool Complete_(Conn &c, int64_t now);
+        void Record_(const Pending &p, int status, int64_t now);
+        bool OnReady_(Conn &c, int64_t now);
+        void Schedule_(int64_t now);
+        void ArmTimer_(int64_t ns);
+        int PickScenario_();
+        bool HasSlot_(const Conn &c) const;
+        size_t Inflight_() const;
+
+        const Options &opt_;
+        int id_;
+        std::vector<Conn> conns_;
+        int64_t interval_;
+        int epollFd_;
+        int timerFd_;
+        uint64_t seed_;
+        int totalWeight_;
+        uint64_t regSeq_;
+        size_t cursor_;
+        std::deque<int64_t> backlog_; // 定速模式下已到排定时间、等待空闲连接的请求
+        int64_t nextNs_;
+        int64_t startNs_, measureNs_, endNs_;
+    };
+
+    int Worker::PickScenario_()
+    {
+        seed_ ^= seed_ << 13;
+        seed_ ^= seed_ >> 7;
+        seed_ ^= seed_ << 17;
+        int r = static_cast<int>(seed_ % static_cast<uint64_t>(totalWeight_));
+        for (int i = 0; i < SCENARIO_COUNT; i++)
+        {
+            if (r < opt_.weights[i])
+            {
+                return i;
+            }
+            r -= opt_.weights[i];
+        }
+        return INDEX;
+    }
+
+    bool Worker::HasSlot_(const Conn &c) const
+    {
+        return c.fd >= 0 && !c.connecting && !c.closeAfter &&
+               static_cast<int>(c.inflight.size()) < (opt_.keepAlive ? opt_.depth : 1);
+    }
+
+    size_t Worker::Inflight_() const
+    {
+        size_t n = 0;
+        for (auto &c : conns_)
+        {
+            n += c.inflight.size();
+        }
+        return n;
+    }
+
+    void Worker::Update_(Conn &c)
+    {
+        uint32_t events = EPOLLIN | ((c.connecting || c.outPos < c.out.size()) ? static_cast<uint32_t>(EPOLLOUT) : 0u);
+        if (events != c.events)
+        {
+            epoll_event ev = {};
+            ev.events = events;
+            ev.data.ptr = &c;
+            epoll_ctl(epollFd_, EPOLL_CTL_MOD, c.fd, &ev);
+            c.events = events;
+        }
+    }
+
+    void Worker::Connect_(Conn &c, int64_t now)
+    {
+        c.fd = socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK, 0);
+        if (c.fd < 0)
+        {
+            stats.connectErrors++;
+            c.retryNs = now + RECONNECT_NS;
+            return;
+        }
+        int one = 1;
+        setsockopt(c.fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+        sockaddr_in addr = {};
+        addr.sin_family = AF_INET;
+        addr.sin_port = htons(static_cast<uint16_t>(opt_.port));
+        inet_pton(AF_INET, opt_.host.c_str(), &addr.sin_addr);
+        if (connect(c.fd, reinterpret_cast<sockaddr *>(&addr), sizeof(addr)) < 0 && errno != EINPROGRESS)
+        {
+            close(c.fd);
+            c.fd = -1;
+            stats.connectErrors++;
+            c.retryNs = now + RECONNECT_NS;
+            return;
+        }
+        c.connecting = true;
+        c.events = EPOLLIN | EPOLLOUT;
+        epoll_event ev = {};
+        ev.events = c.events;
+        ev.data.ptr = &c;
+        epoll_ctl(epollFd_, EPOLL_CTL_ADD, c.fd, &ev);
+    }
+
+    // 关闭连接，仍在途的请求记为错误；测量结束前立即重连
+    void Worker::Close_(Conn &c, int64_t now)
+    {
+        if (c.fd >= 0)
+        {
+            epoll_ctl(epollFd_, EPOLL_CTL_DEL, c.fd, nullptr);
+            close(c.fd);
+        }
+        stats.errors += c.inflight.size();
+        c.fd = -1;
+        c.connecting = false;
+        c.events = 0;
+        c.out.clear();
+        c.outPos = 0;
+        c.inflight.clear();
+        c.head.clear();
+        c.inBody = false;
+        c.closeAfter = false;
+        c.retryNs = now;
+        if (now < endNs_)
+        {
+            Connect_(c, now);
+        }
+    }
+
+    void Worker::Send_(Conn &c, int scenario, int64_t intendedNs, int64_t now)
+    {
+        const char *connection = opt_.keepAlive ? "keep-alive" : "close";
+        char buf[512];
+        int n = 0;
+        if (scenario == INDEX || scenario == IMAGE)
+        {
+            n = snprintf(buf, sizeof(buf), "GET %s HTTP/1.1\r\nHost: %s:%d\r\nConnection: %s\r\n\r\n",
+                         scenario == INDEX ? "/index.html" : "/images/instagram-image4.jpg", opt_.host.c_str(),
+                         opt_.port, connection);
+        }
+        else
+        {
+            char body[128];
+            int len;
+            if (scenario == LOGIN)
+            {
+                len = snprintf(body, sizeof(body), "username=bench&password=bench");
+            }
+            else
+            {
+                len = snprintf(body, sizeof(body), "username=bench_%d_%d_%llu&password=bench", static_cast<int>(getpid()),
+                               id_, static_cast<unsigned long long>(regSeq_++));
+            }
+            // 服务端把空行后的内容当作请求体，请求体后不能再跟换行
+            n = snprintf(buf, sizeof(buf),
+                         "POST %s HTTP/1.1\r\nHost: %s:%d\r\nConnection: %s\r\n"
+                         "Content-Type: application/x-www-form-urlencoded\r\nContent-Length: %d\r\n\r\n%s",
+                         scenario == LOGIN ? "/login" : "/register", opt_.host.c_str(), opt_.port, connection, len, body);
+        }
+        c.out.append(buf, static_cast<size_t>(n));
+        c.inflight.push_back(Pending{scenario, intendedNs, now});
+    }
+
+    bool Worker::Flush_(Conn &c)
+    {
+        while (c.outPos < c.out.size())
+        {
+            ssize_t len = write(c.fd, c.out.data() + c.outPos, c.out.size() - c.outPos);
+            if (len < 0)
+            {
+                if (errno == EAGAIN || errno == EINTR)
+                {
+                    break;
+                }
+                return false;
+            }
+            c.outPos += static_cast<size_t>(len);
+        }
+        if (c.outPos == c.out.size())
+        {
+            c.out.clear();
+            c.outPos = 0;
+        }
+        Update_(c);
+        return true;
+    }
+
+    bool Worker::Read_(Conn &c, int64_t now)
+    {
+        char buf[64 * 1024];
+        while (true)
+        {
+            ssize_t len = read(c.fd, buf, sizeof(buf));
+            if (len > 0)
+            {
+                stats.bytes += static_cast<uint64_t>(len);
+                if (!Consume_(c, buf, static_cast<size_t>(len), now))
+                {
+                    return false;
+                }
+                continue;
+            }
+            if (len < 0 && (errno == EAGAIN || errno == EINTR))
+            {
+                return true;
+            }
+            return false; // 对端关闭或出错
+        }
+    }
+
+    // 响应体只计数不保存，大文件不会拷贝
+    bool Worker::Consume_(Conn &c, const char *data, size_t len, int64_t now)
+    {
+        while (len > 0)
+        {
+            if (c.inBody)
+            {
+                size_t n = std::min(len, static_cast<size_t>(c.bodyLeft));
+                data += n;
+                len -= n;
+                c.bodyLeft -= static_cast<int64_t>(n);
+                if (c.bodyLeft == 0 && !Complete_(c, now))
+                {
+                    return false;
+                }
+                continue;
+            }
+            size_t before = c.head.size();
+            c.head.append(data, len);
+            size_t end = c.head.find("\r\n\r\n", before >= 3 ? before - 3 : 0);
+            if (end == std::string::npos)
+            {
+                return c.head.size() <= MAX_HEAD;
+            }
+            size_t used = end + 4 - before;
+            if (!ParseHead_(c, end))
+            {
+                return false;
+            }
+            data += used;
+            len -= used;
+            c.head.clear();
+            if (c.bodyLeft == 0 && !Complete_(c, now))
+            {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    bool Worker::ParseHead_(Conn &c, size_t end)
+    {
+        if (c.inflight.empty() || c.head.compare(0, 9, "HTTP/1.1 ") != 0)
+        {
+            return false;
+        }
+        c.status = atoi(c.head.c_str() + 9);
+        c.bodyLeft = 0;
+        // 头部名不区分大小写，服务端发送的是 Content-length
+        size_t pos = 0;
+        while ((pos = c.head.find("\r\n", pos)) != std::string::npos && pos < end)
+        {
+            pos += 2;
+            const char *line = c.head.c_str() + pos;
+            if (strncasecmp(line, "Content-Length:", 15) == 0)
+            {
+                c.bodyLeft = atoll(line + 15);
+            }
+            else if (strncasecmp(line, "Connection:", 11) == 0)
+            {
+                const char *value = line + 11;
+                while (*value == ' ')
+                {
+                    value++;
+                }
+                c.closeAfter = strncasecmp(value, "close", 5) == 0;
+            }
+        }
+        c.inBody = true;
+        return true;
+    }
+
+    bool Worker::Complete_(Conn &c, int64_t now)
+    {
+        Pending p = c.inflight.front();
+        c.inflight.pop_front();
+        c.inBody = false;
+        Record_(p, c.status, now);
+        if (c.closeAfter)
+        {
+            return false; // 服务端将关闭连接，之后的在途请求记为错误
+        }
+        return OnReady_(c, now);
+    }
+
+    void Worker::Record_(const Pending &p, int status, int64_t now)
+    {
+        // 只统计在测量窗口内完成的请求，过载时预热期积压的请求也按完整延迟计入
+        if (now < measureNs_ || now >= endNs_)
+        {
+            return;
+        }
+        int64_t latency = (now - p.intendedNs) / 1000;
+        int64_t service = (now - p.sentNs) / 1000;
+        stats.latencyUs[p.scenario].push_back(static_cast<uint32_t>(std::min<int64_t>(latency, UINT32_MAX)));
+        stats.serviceUs[p.scenario].push_back(static_cast<uint32_t>(std::min<int64_t>(service, UINT32_MAX)));
+        int cls = status / 100;
+        stats.status[(cls >= 1 && cls <= 5) ? cls - 1 : 5]++;
+    }
+
+    // 连接可以发送新请求：闭环模式补满流水线，定速模式从积压队列取；写出失败返回 false，由调用方关闭
+    bool Worker::OnReady_(Conn &c, int64_t now)
+    {
+        if (now < startNs_ || now >= endNs_)
+        {
+            return true;
+        }
+        while (HasSlot_(c))
+        {
+            if (interval_ == 0)
+            {
+                Send_(c, PickScenario_(), now, now);
+            }
+            else if (!backlog_.empty())
+            {
+                Send_(c, PickScenario_(), backlog_.front(), now);
+                backlog_.pop_front();
+            }
+            else
+            {
+                break;
+            }
+        }
+        return c.outPos == c.out.size() || Flush_(c);
+    }
+
+    // 定速模式：把到期的排定时间放进积压队列，再分给有空位的连接
+    void Worker::Schedule_(int64_t now)
+    {
+        while (nextNs_ <= now && nextNs_ < endNs_)
+        {
+            backlog_.push_back(nextNs_);
+            nextNs_ += interval_;
+        }
+        for (size_t i = 0; i < conns_.size() && !backlog_.empty(); i++)
+        {
+            Conn &c = conns_[cursor_];
+            cursor_ = (cursor_ + 1) % conns_.size();
+            if (HasSlot_(c) && !OnReady_(c, now))
+            {
+                Close_(c, now);
+            }
+        }
+        if (nextNs_ < endNs_)
+        {
+            ArmTimer_(nextNs_);
+        }
+    }
+
+    void Worker::ArmTimer_(int64_t ns)
+    {
+        itimerspec spec = {};
+        spec.it_value.tv_sec = ns / NS_PER_SEC;
+        spec.it_value.tv_nsec = ns % NS_PER_SEC;
+        timerfd_settime(timerFd_, TFD_TIMER_ABSTIME, &spec, nullptr);
+    }
+
+    void Worker::Run(int64_t startNs, int64_t measureNs, int64_t endNs)
+    {
+        startNs_ = startNs;
+        measureNs_ = measureNs;
+        endNs_ = endNs;
+        nextNs_ = startNs;
+        epollFd_ = epoll_create1(0);
+        // 定时器精确到纳秒，排定时间不受 epoll_wait 毫秒超时的影响
+        timerFd_ = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK);
+        epoll_event tev = {};
+        tev.events = EPOLLIN;
+        tev.data.ptr = nullptr;
+        epoll_ctl(epollFd_, EPOLL_CTL_ADD, timerFd_, &tev);
+        if (interval_ > 0)
+        {
+            ArmTimer_(startNs_);
+        }
+
+        int64_t now = NowNs();
+        for (auto &c : conns_)
+        {
+            Connect_(c, now);
+        }
+
+        bool started = false;
+        std::vector<epoll_event> events(conns_.size() + 1);
+        while (true)
+        {
+            now = NowNs();
+            if (now >= endNs_ && (Inflight_() == 0 || now >= endNs_ + DRAIN_NS))
+            {
+                break;
+            }
+            if (!started && now >= startNs_ && interval_ == 0)
+            {
+                started = true;
+                for (auto &c : conns_)
+                {
+                    if (!OnReady_(c, now))
+                    {
+                        Close_(c, now);
+                    }
+                }
+            }
+            int64_t wakeNs = now + RECONNECT_NS;
+            for (auto &c : conns_)
+            {
+                if (c.fd < 0 && now < endNs_)
+                {
+                    if (c.retryNs <= now)
+                    {
+                        Connect_(c, now);
+                    }
+                    else
+                    {
+                        wakeNs = std::min(wakeNs, c.retryNs);
+                    }
+                }
+            }
+            wakeNs = std::min(wakeNs, now < startNs_ ? startNs_ : (now < endNs_ ? endNs_ : endNs_ + DRAIN_NS));
+            int timeoutMs = static_cast<int>((wakeNs - now + 999999) / 1000000);
+            int n = epoll_wait(epollFd_, events.data(), static_cast<int>(events.size()), std::max(timeoutMs, 0));
+            now = NowNs();
+            for (int i = 0; i < n; i++)
+            {
+                if (events[i].data.ptr == nullptr)
+                {
+                    uint64_t expirations;
+                    ssize_t ret = read(timerFd_, &expirations, sizeof(expirations));
+                    (void)ret;
+                    Schedule_(now);
+                    continue;
+                }
+                Conn &c = *static_cast<Conn *>(events[i].data.ptr);
+                if (c.fd < 0)
+                {
+                    continue; // 同一轮中已被关闭
+                }
+                uint32_t ev = events[i].events;
+                if (c.connecting)
+                {
+                    int err = 0;
+                    socklen_t errLen = sizeof(err);
+                    getsockopt(c.fd, SOL_SOCKET, SO_ERROR, &err, &errLen);
+                    if (err != 0 || (ev & (EPOLLERR | EPOLLHUP)))
+                    {
+                        stats.connectErrors++;
+                        epoll_ctl(epollFd_, EPOLL_CTL_DEL, c.fd, nullptr);
+                        close(c.fd);
+                        c.fd = -1;
+                        c.connecting = false;
+                        c.retryNs = now + RECONNECT_NS;
+                        continue;
+                    }
+                    c.connecting = false;
+                    stats.connects++;
+                    Update_(c);
+                    if (!OnReady_(c, now))
+                    {
+                        Close_(c, now);
+                        continue;
+                    }
+                    if (interval_ > 0 && c.fd >= 0)
+                    {
+                        Schedule_(now);
+                    }
+                    continue;
+                }
+                if ((ev & EPOLLOUT) && !Flush_(c))
+                {
+                    Close_(c, now);
+                    continue;
+                }
+                if ((ev & (EPOLLIN | EPOLLHUP | EPOLLERR)) && !Read_(c, now))
+                {
+                    Close_(c, now);
+                    continue;
+                }
+            }
+        }
+
+        stats.timeouts = Inflight_();
+        stats.unsent = backlog_.size();
+        for (auto &c : conns_)
+        {
+            if (c.fd >= 0)
+            {
+                close(c.fd);
+            }
+            c.inflight.clear();
+        }
+        close(timerFd_);
+        close(epollFd_);
+    }
+
+    // 解析 index=70,image=20,login=8,register=2
+    bool ParseMix(const char *spec, int weights[SCENARIO_COUNT])
+    {
+        std::fill(weights, weights + SCENARIO_COUNT, 0);
+        std::string s(spec);
+        size_t pos = 0;
+        while (pos < s.size())
+        {
+            size_t comma = s.find(',', pos);
+            std::string item = s.substr(pos, comma == std::string::npos ? std::string::npos : comma - pos);
+            pos = comma == std::string::npos ? s.size() : comma + 1;
+            size_t eq = item.find('=');
+            if (eq == std::string::npos)
+            {
+                return false;
+            }
+            std::string name = item.substr(0, eq);
+            int i = 0;
+            while (i < SCENARIO_COUNT && name != SCENARIO_NAME[i])
+            {
+                i++;
+            }
+            if (i == SCENARIO_COUNT)
+            {
+                return false;
+            }
+            weights[i] = atoi(item.c_str() + eq + 1);
+        }
+        int total = 0;
+        for (int i = 0; i < SCENARIO_COUNT; i++)
+        {
+            total += std::max(weights[i], 0);
+        }
+        return total > 0;
+    }
+
+    // 输出一组延迟的均值与分位数（微秒），samples 会被排序
+    void AppendLatency(std::string &out, std::vector<uint32_t> &samples)
+    {
+        char buf[256];
+        if (samples.empty())
+        {
+            out += "{\"mean\": 0, \"p50\": 0, \"p90\": 0, \"p99\": 0, \"p999\": 0, \"p9999\": 0, \"max\": 0}";
+            return;
+        }
+        std::sort(samples.begin(), samples.end());
+        double sum = 0;
+        for (uint32_t v : samples)
+        {
+            sum += v;
+        }
+        auto at = [&samples](double p) {
+            size_t rank = static_cast<size_t>(std::ceil(p * samples.size()));
+            return samples[rank == 0 ? 0 : rank - 1];
+        };
+        snprintf(buf, sizeof(buf),
+                 "{\"mean\": %.1f, \"p50\": %u, \"p90\": %u, \"p99\": %u, \"p999\": %u, \"p9999\": %u, \"max\": %u}",
+                 sum / samples.size(), at(0.5), at(0.9), at(0.99), at(0.999), at(0.9999), samples.back());
+        out += buf;
+    }
+
+    void Usage(const char *prog)
+    {
+        fprintf(stderr,
+                "usage: %s [-a host] [-p port] [-t threads] [-c connections] [-d seconds] [-w warmup seconds]\n"
+                "          [-r requests/s, 0 = closed loop] [-P pipeline depth] [-k 1|0 keep-alive]\n"
+                "          [-m index=70,image=20,login=8,register=2] [-o output file]\n",
+                prog);
+    }
+}
+
+int main(int argc, char *argv[])
+{
+    Options opt;
+    int ch;
+    while ((ch = getopt(argc, argv, "a:p:t:c:d:w:r:P:k:m:o:h")) != -1)
+    {
+        switch (ch)
+        {
+        case 'a':
+            opt.host = optarg;
+            break;
+        case 'p':
+            opt.port = atoi(optarg);
+            break;
+        case 't':
+            opt.threads = atoi(optarg);
+            break;
+        case 'c':
+            opt.connections = atoi(optarg);
+            break;
+        case 'd':
+            opt.duration = atof(optarg);
+            break;
+        case 'w':
+            opt.warmup = atof(optarg);
+            break;
+        case 'r':
+            opt.rate = atof(optarg);
+            break;
+        case 'P':
+            opt.depth = atoi(optarg);
+            break;
+        case 'k':
+            opt.keepAlive = atoi(optarg) != 0;
+            break;
+        case 'm':
+            if (!ParseMix(optarg, opt.weights))
+            {
+                fprintf(stderr, "bad mix: %s\n", optarg);
+                return 1;
+            }
+            break;
+        case 'o':
+            opt.output = optarg;
+            break;
+        default:
+            Usage(argv[0]);
+            return 1;
+        }
+    }
+    in_addr probe;
+    if (opt.threads <= 0 || opt.connections < opt.threads || opt.depth <= 0 || opt.duration <= 0 ||
+        opt.warmup < 0 || opt.rate < 0 || inet_pton(AF_INET, opt.host.c_str(), &probe) != 1)
+    {
+        Usage(argv[0]);
+        return 1;
+    }
+    if (!opt.keepAlive)
+    {
+        opt.depth = 1; // 短连接每个连接只发一个请求
+    }
+
+    std::vector<std::unique_ptr<Worker>> workers;
+    for (int i = 0; i < opt.threads; i++)
+    {
+        int conns = opt.connections / opt.threads + (i < opt.connections % opt.threads ? 1 : 0);
+        workers.emplace_back(new Worker(opt, i, conns, opt.rate / opt.threads));
+    }
+    // 留出建立连接的时间，预热期内的请求不计入结果
+    int64_t startNs = NowNs() + NS_PER_SEC / 10;
+    int64_t measureNs = startNs + static_cast<int64_t>(opt.warmup * NS_PER_SEC);
+    int64_t endNs = measureNs + static_cast<int64_t>(opt.duration * NS_PER_SEC);
+    std::vector<std::thread> threads;
+    for (auto &w : workers)
+    {
+        Worker *worker = w.get();
+        threads.emplace_back([=]() { worker->Run(startNs, measureNs, endNs); });
+    }
+    for (auto &t : threads)
+    {
+        t.join();
+    }
+
+    // 汇总各线程结果
+    Stats total;
+    std::vector<uint32_t> allLatency, allService;
+    for (auto &w : workers)
+    {
+        Stats &s = w->stats;
+        for (int i = 0; i < SCENARIO_COUNT; i++)
+        {
+            total.latencyUs[i].insert(total.latencyUs[i].end(), s.latencyUs[i].begin(), s.latencyUs[i].end());
+            total.serviceUs[i].insert(total.serviceUs[i].end(), s.serviceUs[i].begin(), s.serviceUs[i].end());
+        }
+        for (int i = 0; i < 6; i++)
+        {
+            total.status[i] += s.status[i];
+        }
+        total.bytes += s.bytes;
+        total.errors += s.errors;
+        total.connectErrors += s.connectErrors;
+        total.connects += s.connects;
+        total.timeouts += s.timeouts;
+        total.unsent += s.unsent;
+    }
+    for (int i = 0; i < SCENARIO_COUNT; i++)
+    {
+        allLatency.insert(allLatency.end(), total.latencyUs[i].begin(), total.latencyUs[i].end());
+        allService.insert(allService.end(), total.serviceUs[i].begin(), total.serviceUs[i].end());
+    }
+    uint64_t requests = allLatency.size();
+
+    std::string out;
+    char buf[512];
+    snprintf(buf, sizeof(buf),
+             "{\n  \"config\": {\"host\": \"%s\", \"port\": %d, \"threads\": %d, \"connections\": %d, "
+             "\"duration_s\": %g, \"warmup_s\": %g, \"rate\": %g, \"pipeline\": %d, \"keep_alive\": %s, \"mix\": {",
+             opt.host.c_str(), opt.port, opt.threads, opt.connections, opt.duration, opt.warmup, opt.rate, opt.depth,
+             opt.keepAlive ? "true" : "false");
+    out += buf;
+    for (int i = 0; i < SCENARIO_COUNT; i++)
+    {
+        snprintf(buf, sizeof(buf), "%s\"%s\": %d", i ? ", " : "", SCENARIO_NAME[i], opt.weights[i]);
+        out += buf;
+    }
+    snprintf(buf, sizeof(buf),
+             "}},\n  \"requests\": %llu,\n  \"throughput_rps\": %.1f,\n  \"received_bytes\": %llu,\n"
+             "  \"connects\": %llu,\n  \"connect_errors\": %llu,\n  \"errors\": %llu,\n  \"timeouts\": %llu,\n"
+             "  \"unsent\": %llu,\n",
+             static_cast<unsigned long long>(requests), requests / opt.duration,
+             static_cast<unsigned long long>(total.bytes), static_cast<unsigned long long>(total.connects),
+             static_cast<unsigned long long>(total.connectErrors), static_cast<unsigned long long>(total.errors),
+             static_cast<unsigned long long>(total.timeouts), static_cast<unsigned long long>(total.unsent));
+    out += buf;
+    snprintf(buf, sizeof(buf),
+             "  \"status\": {\"1xx\": %llu, \"2xx\": %llu, \"3xx\": %llu, \"4xx\": %llu, \"5xx\": %llu, \"other\": %llu},\n",
+             static_cast<unsigned long long>(total.status[0]), static_cast<unsigned long long>(total.status[1]),
+             static_cast<unsigned long long>(total.status[2]), static_cast<unsigned long long>(total.status[3]),
+             static_cast<unsigned long long>(total.status[4]), static_cast<unsigned long long>(total.status[5]));
+    out += buf;
+    // 闭环模式下两者相同；定速模式下 latency 含客户端排队时间
+    out += "  \"latency_us\": ";
+    AppendLatency(out, allLatency);
+    out += ",\n  \"service_us\": ";
+    AppendLatency(out, allService);
+    out += ",\n  \"scenarios\": {";
+    bool first = true;
+    for (int i = 0; i < SCENARIO_COUNT; i++)
+    {
+        if (opt.weights[i] <= 0)
+        {
+            continue;
+        }
+        snprintf(buf, sizeof(buf), "%s\n    \"%s\": {\"requests\": %llu, \"throughput_rps\": %.1f, \"latency_us\": ",
+                 first ? "" : ",", SCENARIO_NAME[i], static_cast<unsigned long long>(total.latencyUs[i].size()),
+                 total.latencyUs[i].size() / opt.duration);
+        out += buf;
+        AppendLatency(out, total.latencyUs[i]);
+        out += "}";
+        first = false;
+    }
+    out += "\n  }\n}\n";
+
+    FILE *fp = opt.output.empty() ? stdout : fopen(opt.output.c_str(), "w");
+    if (fp == nullptr)
+    {
+        fprintf(stderr, "cannot open %s\n", opt.output.c_str());
+        return 1;
+    }
+    fputs(out.c_str(), fp);
+    if (fp != stdout)
+    {
+        fclose(fp);
+    }
+    return total.connects == 0 ? 1 : 0;
+}
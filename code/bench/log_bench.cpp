@@ -0,0 +1,108 @@
+//
+// 日志生产者开销基准：1~32 个线程并发写 INFO，统计每行在调用线程上的耗时
+// 用法：log_bench [每线程行数] [日志目录]
+//
+#include <cstdio>
+#include <cstdlib>
+#include <chrono>
+#include <thread>
+#include <vector>
+#include <atomic>
+#include "../log/log.h"
+
+namespace
+{
+    struct Result
+    {
+        double nsPerLine;           // 单个生产者每行平均耗时
+        double linesPerSec;         // 所有生产者合计吞吐
+        unsigned long long dropped; // 本轮丢弃行数
+        double writesPerLine;       // 每行摊到的 write 系统调用
+    };
+
+    Result Run(int threads, int lines)
+    {
+        std::atomic<long long> totalNs(0);
+        std::atomic<int> ready(0);
+        std::atomic<bool> go(false);
+        unsigned long long droppedBefore = Log::Instance()->Dropped();
+        unsigned long long linesBefore = Log::Instance()->Lines();
+        unsigned long long writesBefore = Log::Instance()->FileWrites();
+
+        std::vector<std::thread> workers;
+        for (int i = 0; i < threads; i++)
+        {
+            workers.emplace_back([&, i]() {
+                ready++;
+                while (!go)
+                {
+                    std::this_thread::yield();
+                }
+                auto start = std::chrono::steady_clock::now();
+                for (int n = 0; n < lines; n++)
+                {
+                    LOG_INFO("Client[%d](%s:%d) in, userCount:%d", 1000 + i, "127.0.0.1", 40000 + n, n);
+                }
+                auto end = std::chrono::steady_clock::now();
+                totalNs += std::chrono::duration_cast<std::chrono::nanoseconds>(end - start).count();
+            });
+        }
+        while (ready < threads)
+        {
+            std::this_thread::yield();
+        }
+        auto begin = std::chrono::steady_clock::now();
+        go = true;
+        for (auto &t : workers)
+        {
+            t.join();
+        }
+        double sec = std::chrono::duration<double>(std::chrono::steady_clock::now() - begin).count();
+        std::this_thread::sleep_for(std::chrono::milliseconds(300)); //等后台线程写完本轮
+
+        Result r;
+        r.nsPerLine = static_cast<double>(totalNs) / (static_cast<double>(threads) * lines);
+        r.linesPerSec = threads * static_cast<double>(lines) / sec;
+        r.dropped = Log::Instance()->Dropped() - droppedBefore;
+        unsigned long long written = Log::Instance()->Lines() - linesBefore;
+        r.writesPerLine = written ? static_cast<double>(Log::Instance()->FileWrites() - writesBefore) / written : 0.0;
+        return r;
+    }
+}
+
+int main(int argc, char *argv[])
+{
+    int lines = argc > 1 ? atoi(argv[1]) : 100000;
+    const char *dir = argc > 2 ? argv[2] : "./bench_log";
+    const int threadCounts[] = {1, 2, 4, 8, 16, 32};
+
+    struct Mode
+    {
+        const char *name;
+        int queueSize;
+        Log::OVERFLOW_POLICY policy;
+        Log::LOG_FORMAT format;
+        const char *suffix;
+    };
+    const Mode modes[] = {
+        {"sync", 0, Log::LOG_BLOCK, Log::LOG_FORMAT_TEXT, ".log"},
+        {"async-block", 1024, Log::LOG_BLOCK, Log::LOG_FORMAT_TEXT, ".log"},
+        {"async-drop", 1024, Log::LOG_DROP, Log::LOG_FORMAT_TEXT, ".log"},
+        {"deferred", 1024, Log::LOG_BLOCK, Log::LOG_FORMAT_DEFERRED, ".log"},
+        {"binary", 1024, Log::LOG_BLOCK, Log::LOG_FORMAT_BINARY, ".blog"},
+        {"binary-drop", 1024, Log::LOG_DROP, Log::LOG_FORMAT_BINARY, ".blog"},
+    };
+
+    printf("%-12s %8s %12s %14s %10s %12s\n", "mode", "threads", "ns/line", "lines/s", "dropped", "writes/line");
+    for (const Mode &mode : modes)
+    {
+        Log::Instance()->init(1, dir, mode.suffix, mode.queueSize, mode.policy, mode.format);
+        for (int threads : threadCounts)
+        {
+            Result r = Run(threads, lines);
+            printf("%-12s %8d %12.1f %14.0f %10llu %12.5f\n", mode.name, threads, r.nsPerLine, r.linesPerSec, r.dropped,
+                   r.writesPerLine);
+        }
+    }
+    return 0;
+}
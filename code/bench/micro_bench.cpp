@@ -0,0 +1,336 @@
+//
+// 核心组件微基准（Google Benchmark）：Buffer、请求解析、响应组装、定时器、线程池、阻塞队列、日志
+// 用法：microbench --benchmark_format=json --benchmark_out=result.json [--benchmark_filter=Buffer]
+// 响应组装使用仓库中的 resources 目录，日志写到当前目录下的 bench_log
+//
+#include <benchmark/benchmark.h>
+#include <atomic>
+#include <string>
+#include <thread>
+#include <vector>
+#include <random>
+#include <cstring>
+#include <algorithm>
+#include <unistd.h>
+#include <sys/socket.h>
+#include "../buffer/buffer.h"
+#include "../http/http_request.h"
+#include "../http/http_response.h"
+#include "../cache/file_cache.h"
+#include "../timer/heap_timer.h"
+#include "../pool/threadpool.h"
+#include "../log/blockDeque.h"
+#include "../log/log.h"
+
+namespace
+{
+    // 浏览器实际发出的请求头
+    const char CHROME_GET[] =
+        "GET /index.html HTTP/1.1\r\n"
+        "Host: 127.0.0.1:8080\r\n"
+        "Connection: keep-alive\r\n"
+        "Cache-Control: max-age=0\r\n"
+        "sec-ch-ua: \"Chromium\";v=\"124\", \"Google Chrome\";v=\"124\", \"Not-A.Brand\";v=\"99\"\r\n"
+        "sec-ch-ua-mobile: ?0\r\n"
+        "sec-ch-ua-platform: \"Linux\"\r\n"
+        "Upgrade-Insecure-Requests: 1\r\n"
+        "User-Agent: Mozilla/5.0 (X11; Linux x86_64) AppleWebKit/537.36 (KHTML, like Gecko) "
+        "Chrome/124.0.0.0 Safari/537.36\r\n"
+        "Accept: text/html,application/xhtml+xml,application/xml;q=0.9,image/avif,image/webp,image/apng,"
+        "*/*;q=0.8,application/signed-exchange;v=b3;q=0.7\r\n"
+        "Sec-Fetch-Site: none\r\n"
+        "Sec-Fetch-Mode: navigate\r\n"
+        "Sec-Fetch-User: ?1\r\n"
+        "Sec-Fetch-Dest: document\r\n"
+        "Accept-Encoding: gzip, deflate, br, zstd\r\n"
+        "Accept-Language: zh-CN,zh;q=0.9,en;q=0.8\r\n"
+        "\r\n";
+
+    const char CURL_GET[] =
+        "GET / HTTP/1.1\r\n"
+        "Host: 127.0.0.1:8080\r\n"
+        "User-Agent: curl/8.5.0\r\n"
+        "Accept: */*\r\n"
+        "\r\n";
+
+    const char LOGIN_POST[] =
+        "POST /login HTTP/1.1\r\n"
+        "Host: 127.0.0.1:8080\r\n"
+        "Connection: keep-alive\r\n"
+        "Content-Length: 29\r\n"
+        "Origin: http://127.0.0.1:8080\r\n"
+        "Content-Type: application/x-www-form-urlencoded\r\n"
+        "User-Agent: Mozilla/5.0 (X11; Linux x86_64) AppleWebKit/537.36 (KHTML, like Gecko) "
+        "Chrome/124.0.0.0 Safari/537.36\r\n"
+        "Accept: text/html,application/xhtml+xml,application/xml;q=0.9,*/*;q=0.8\r\n"
+        "Referer: http://127.0.0.1:8080/login.html\r\n"
+        "Accept-Encoding: gzip, deflate, br, zstd\r\n"
+        "Accept-Language: zh-CN,zh;q=0.9,en;q=0.8\r\n"
+        "\r\n"
+        "username=bench&password=bench";
+
+    const char *REQUESTS[] = {CURL_GET, CHROME_GET, LOGIN_POST};
+    const char *REQUEST_NAME[] = {"curl_get", "chrome_get", "login_post"};
+
+    const char *PATHS[] = {"/index.html", "/images/instagram-image4.jpg", "/missing.html"};
+    const char *PATH_NAME[] = {"index", "image_100k", "not_found"};
+
+    // ---------------- Buffer ----------------
+    void BM_BufferAppend(benchmark::State &state)
+    {
+        std::string chunk(static_cast<size_t>(state.range(0)), 'x');
+        Buffer buff;
+        for (auto _ : state)
+        {
+            buff.Append(chunk);
+            buff.RetrieveAll();
+        }
+        state.SetBytesProcessed(state.iterations() * state.range(0));
+    }
+    BENCHMARK(BM_BufferAppend)->RangeMultiplier(8)->Range(16, 64 << 10);
+
+    // 每次写入 n 字节、取出一半，未读数据不断前移，反复触发 MakeSpace_ 的搬移与扩容
+    void BM_BufferMakeSpace(benchmark::State &state)
+    {
+        size_t n = static_cast<size_t>(state.range(0));
+        std::string chunk(n, 'x');
+        Buffer buff;
+        for (auto _ : state)
+        {
+            buff.Append(chunk);
+            buff.Retrieve(n / 2 + (buff.ReadableBytes() > 4 * n ? n : 0));
+        }
+        state.SetBytesProcessed(state.iterations() * state.range(0));
+    }
+    BENCHMARK(BM_BufferMakeSpace)->RangeMultiplier(8)->Range(64, 64 << 10);
+
+    // 含对端 write 的开销
+    void BM_BufferReadFd(benchmark::State &state)
+    {
+        int fds[2];
+        if (socketpair(AF_UNIX, SOCK_STREAM, 0, fds) < 0)
+        {
+            state.SkipWithError("socketpair failed");
+            return;
+        }
+        std::string chunk(static_cast<size_t>(state.range(0)), 'x');
+        Buffer buff;
+        int err = 0;
+        for (auto _ : state)
+        {
+            ssize_t len = write(fds[1], chunk.data(), chunk.size());
+            benchmark::DoNotOptimize(len);
+            buff.ReadFd(fds[0], &err);
+            buff.RetrieveAll();
+        }
+        state.SetBytesProcessed(state.iterations() * state.range(0));
+        close(fds[0]);
+        close(fds[1]);
+    }
+    BENCHMARK(BM_BufferReadFd)->RangeMultiplier(8)->Range(64, 64 << 10);
+
+    // ---------------- HttpRequest ----------------
+    void BM_HttpRequestParse(benchmark::State &state)
+    {
+        const char *raw = REQUESTS[state.range(0)];
+        size_t len = strlen(raw);
+        Buffer buff;
+        HttpRequest request;
+        for (auto _ : state)
+        {
+            buff.Append(raw, len);
+            request.Init();
+            benchmark::DoNotOptimize(request.parse(buff));
+            buff.RetrieveAll();
+        }
+        state.SetLabel(REQUEST_NAME[state.range(0)]);
+        state.SetBytesProcessed(state.iterations() * static_cast<int64_t>(len));
+    }
+    BENCHMARK(BM_HttpRequestParse)->DenseRange(0, 2);
+
+    // ---------------- HttpResponse ----------------
+    // range(1) 为 1 时使用文件缓存，否则每次 stat/open/mmap
+    void BM_HttpResponseMask(benchmark::State &state)
+    {
+        FileCache cache(64, 60000);
+        HttpResponse::fileCache = state.range(1) ? &cache : nullptr;
+        const std::string srcDir = RESOURCES_DIR;
+        Buffer buff;
+        HttpResponse response;
+        for (auto _ : state)
+        {
+            std::string path = PATHS[state.range(0)];
+            response.Init(srcDir, path, true, 200);
+            response.MaskResponse(buff);
+            benchmark::DoNotOptimize(response.File());
+            response.UnmapFile();
+            buff.RetrieveAll();
+        }
+        HttpResponse::fileCache = nullptr;
+        state.SetLabel(std::string(PATH_NAME[state.range(0)]) + (state.range(1) ? "/cached" : "/uncached"));
+    }
+    BENCHMARK(BM_HttpResponseMask)->ArgsProduct({{0, 1, 2}, {0, 1}});
+
+    // ---------------- HeapTimer ----------------
+    std::vector<int> TimerIds(size_t n)
+    {
+        std::vector<int> ids(n);
+        for (size_t i = 0; i < n; i++)
+        {
+            ids[i] = static_cast<int>(i) + 1000; // 与文件描述符相近的 id
+        }
+        std::shuffle(ids.begin(), ids.end(), std::mt19937(42));
+        return ids;
+    }
+
+    // 向空堆加入 n 个超时各异的定时器
+    void BM_HeapTimerAdd(benchmark::State &state)
+    {
+        std::vector<int> ids = TimerIds(static_cast<size_t>(state.range(0)));
+        HeapTimer timer;
+        for (auto _ : state)
+        {
+            for (size_t i = 0; i < ids.size(); i++)
+            {
+                timer.add(ids[i], 60000 + static_cast<int>(i % 1000), [] {});
+            }
+            state.PauseTiming();
+            timer.clear();
+            state.ResumeTiming();
+        }
+        state.SetItemsProcessed(state.iterations() * state.range(0));
+    }
+    BENCHMARK(BM_HeapTimerAdd)->RangeMultiplier(8)->Range(64, 32768);
+
+    // 堆中已有 n 个定时器，逐个延长超时（连接每次活跃时的路径）
+    void BM_HeapTimerAdjust(benchmark::State &state)
+    {
+        std::vector<int> ids = TimerIds(static_cast<size_t>(state.range(0)));
+        HeapTimer timer;
+        for (size_t i = 0; i < ids.size(); i++)
+        {
+            timer.add(ids[i], 60000 + static_cast<int>(i % 1000), [] {});
+        }
+        size_t next = 0;
+        int timeout = 61000;
+        for (auto _ : state)
+        {
+            timer.adjust(ids[next], timeout++);
+            next = next + 1 == ids.size() ? 0 : next + 1;
+        }
+        state.SetItemsProcessed(state.iterations());
+    }
+    BENCHMARK(BM_HeapTimerAdjust)->RangeMultiplier(8)->Range(64, 32768);
+
+    // n 个已到期的定时器由一次 tick 全部触发，计时含加入的开销
+    void BM_HeapTimerTick(benchmark::State &state)
+    {
+        std::vector<int> ids = TimerIds(static_cast<size_t>(state.range(0)));
+        HeapTimer timer;
+        int fired = 0;
+        for (auto _ : state)
+        {
+            for (int id : ids)
+            {
+                timer.add(id, 0, [&fired] { fired++; });
+            }
+            timer.tick();
+        }
+        benchmark::DoNotOptimize(fired);
+        state.SetItemsProcessed(state.iterations() * state.range(0));
+    }
+    BENCHMARK(BM_HeapTimerTick)->RangeMultiplier(8)->Range(64, 32768);
+
+    // ---------------- ThreadPool ----------------
+    // 一个提交线程连续提交一批空任务，等 range(0) 个工作线程全部执行完
+    void BM_ThreadPoolAddTask(benchmark::State &state)
+    {
+        const int batch = 10000;
+        ThreadPool pool(static_cast<size_t>(state.range(0)));
+        std::atomic<int> done(0);
+        for (auto _ : state)
+        {
+            done = 0;
+            for (int i = 0; i < batch; i++)
+            {
+                pool.AddTask([&done] { done.fetch_add(1, std::memory_order_relaxed); });
+            }
+            while (done.load(std::memory_order_relaxed) < batch)
+            {
+                std::this_thread::yield();
+            }
+        }
+        state.SetItemsProcessed(state.iterations() * batch);
+    }
+    BENCHMARK(BM_ThreadPoolAddTask)->RangeMultiplier(2)->Range(1, 8)->UseRealTime();
+
+    // ---------------- BlockDeque ----------------
+    // range(0) 个生产者经容量为 range(1) 的队列交给一个消费者
+    void BM_BlockDeque(benchmark::State &state)
+    {
+        const int perProducer = 20000;
+        int producers = static_cast<int>(state.range(0));
+        BlockDeque<int> deque(static_cast<size_t>(state.range(1)));
+        for (auto _ : state)
+        {
+            std::vector<std::thread> threads;
+            for (int p = 0; p < producers; p++)
+            {
+                threads.emplace_back([&deque] {
+                    for (int i = 0; i < perProducer; i++)
+                    {
+                        deque.push_back(i);
+                    }
+                });
+            }
+            int item;
+            for (int i = 0; i < producers * perProducer; i++)
+            {
+                deque.pop(item);
+            }
+            for (auto &t : threads)
+            {
+                t.join();
+            }
+        }
+        state.SetItemsProcessed(state.iterations() * producers * perProducer);
+    }
+    BENCHMARK(BM_BlockDeque)->ArgsProduct({{1, 2, 4}, {64, 1024}})->UseRealTime();
+
+    // ---------------- Log ----------------
+    // 调用线程上一条 LOG_INFO 的开销，range(0) 为 Log::LOG_FORMAT，-1 表示同步写
+    void LogSetup(const benchmark::State &state)
+    {
+        int format = static_cast<int>(state.range(0));
+        if (format < 0)
+        {
+            Log::Instance()->init(1, "./bench_log", ".log", 0);
+        }
+        else
+        {
+            Log::Instance()->init(1, "./bench_log", format == Log::LOG_FORMAT_BINARY ? ".blog" : ".log", 1024,
+                                  Log::LOG_BLOCK, static_cast<Log::LOG_FORMAT>(format));
+        }
+    }
+
+    void BM_LogWrite(benchmark::State &state)
+    {
+        int n = 0;
+        for (auto _ : state)
+        {
+            LOG_INFO("Client[%d](%s:%d) in, userCount:%d", 1000 + state.thread_index(), "127.0.0.1", 40000 + n, n);
+            n++;
+        }
+        state.SetItemsProcessed(state.iterations());
+    }
+    BENCHMARK(BM_LogWrite)
+        ->Setup(LogSetup)
+        ->ArgName("format")
+        ->Arg(-1)
+        ->Arg(Log::LOG_FORMAT_TEXT)
+        ->Arg(Log::LOG_FORMAT_DEFERRED)
+        ->Arg(Log::LOG_FORMAT_BINARY)
+        ->ThreadRange(1, 8);
+}
+
+BENCHMARK_MAIN();
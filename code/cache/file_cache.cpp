@@ -0,0 +1,53 @@
+#include "file_cache.h"
+#include <sys/mman.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <cerrno>
+
+FileCache::File::~File()
+{
+    if (data)
+    {
+        munmap(data, st.st_size);
+    }
+}
+
+FileCache::FilePtr FileCache::Get(const std::string &path)
+{
+    FilePtr file;
+    if (cache_.Get(path, &file))
+    {
+        return file;
+    }
+    return flight_.Do(path, [this, &path]
+                      {
+        FilePtr loaded = Load_(path);
+        cache_.Put(path, loaded);
+        return loaded; });
+}
+
+FileCache::FilePtr FileCache::Load_(const std::string &path)
+{
+    std::shared_ptr<File> file = std::make_shared<File>();
+    if (stat(path.c_str(), &file->st) < 0)
+    {
+        file->err = errno;
+        return file;
+    }
+    if (S_ISDIR(file->st.st_mode) || !(file->st.st_mode & S_IROTH) || file->st.st_size == 0)
+    {
+        return file; // 由调用方按 stat 结果决定响应码
+    }
+    int fd = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0)
+    {
+        return file;
+    }
+    void *ret = mmap(nullptr, file->st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (ret != MAP_FAILED)
+    {
+        file->data = (char *)ret;
+    }
+    return file;
+}
@@ -0,0 +1,47 @@
+//
+// 静态文件缓存：路径 -> 共享的只读映射（含 stat 结果，失败结果也缓存）
+// 条目在 ttlMs 后过期重新加载，以感知文件变化；并发的未命中通过 SingleFlight 合并为一次加载
+//
+#ifndef FILE_CACHE_H
+#define FILE_CACHE_H
+
+#include <sys/stat.h>
+#include <string>
+#include <memory>
+#include "lru_cache.h"
+#include "single_flight.h"
+
+class FileCache
+{
+public:
+    struct File
+    {
+        File() : err(0), data(nullptr), st() {}
+        ~File();
+
+        int err;         // stat 失败时的 errno，成功为 0（可能是目录或不可读）
+        char *data;      // 可读普通文件的映射，空文件或打开、映射失败时为 nullptr
+        struct stat st;
+
+        File(const File &) = delete;
+        File &operator=(const File &) = delete;
+    };
+    typedef std::shared_ptr<const File> FilePtr; // 最后一个引用释放时解除映射
+
+    FileCache(size_t capacity, int ttlMs) : cache_(capacity, ttlMs) {}
+
+    FilePtr Get(const std::string &path);
+
+    unsigned long long Hits() const { return cache_.Hits(); }
+    unsigned long long Misses() const { return cache_.Misses(); }
+    unsigned long long Fills() const { return flight_.Execs(); }   // 实际 stat/open/mmap 次数
+    unsigned long long Shared() const { return flight_.Shared(); } // 合并掉的并发填充次数
+
+private:
+    static FilePtr Load_(const std::string &path);
+
+    LruCache<std::string, FilePtr> cache_;
+    SingleFlight<std::string, FilePtr> flight_;
+};
+
+#endif
@@ -0,0 +1,132 @@
+//
+// 分片的 TTL + LRU 缓存：按 key 哈希分片，每个分片一把锁，条目超过存活时间后视为未命中
+//
+#ifndef LRU_CACHE_H
+#define LRU_CACHE_H
+
+#include <list>
+#include <mutex>
+#include <vector>
+#include <memory>
+#include <atomic>
+#include <chrono>
+#include <functional>
+#include <unordered_map>
+#include <cassert>
+
+template <class K, class V, class Hash = std::hash<K>>
+class LruCache
+{
+public:
+    typedef std::chrono::steady_clock Clock;
+
+    LruCache(size_t capacity, int ttlMs, size_t shardNum = 16)
+        : ttl_(std::chrono::milliseconds(ttlMs)), hits_(0), misses_(0)
+    {
+        assert(capacity > 0 && ttlMs > 0 && shardNum > 0);
+        size_t perShard = (capacity + shardNum - 1) / shardNum;
+        for (size_t i = 0; i < shardNum; i++)
+        {
+            shards_.emplace_back(new Shard(perShard));
+        }
+    }
+
+    bool Get(const K &key, V *value)
+    {
+        Shard &shard = GetShard_(key);
+        std::lock_guard<std::mutex> locker(shard.mtx);
+        auto it = shard.index.find(key);
+        if (it == shard.index.end())
+        {
+            misses_++;
+            return false;
+        }
+        if (it->second->expires <= Clock::now())
+        {
+            shard.lru.erase(it->second);
+            shard.index.erase(it);
+            misses_++;
+            return false;
+        }
+        shard.lru.splice(shard.lru.begin(), shard.lru, it->second); // 移到表头
+        *value = it->second->value;
+        hits_++;
+        return true;
+    }
+
+    void Put(const K &key, const V &value)
+    {
+        Shard &shard = GetShard_(key);
+        std::lock_guard<std::mutex> locker(shard.mtx);
+        auto it = shard.index.find(key);
+        if (it != shard.index.end())
+        {
+            it->second->value = value;
+            it->second->expires = Clock::now() + ttl_;
+            shard.lru.splice(shard.lru.begin(), shard.lru, it->second);
+            return;
+        }
+        if (shard.index.size() >= shard.capacity)
+        {
+            shard.index.erase(shard.lru.back().key); // 淘汰最久未使用
+            shard.lru.pop_back();
+        }
+        shard.lru.push_front({key, value, Clock::now() + ttl_});
+        shard.index[key] = shard.lru.begin();
+    }
+
+    void Erase(const K &key)
+    {
+        Shard &shard = GetShard_(key);
+        std::lock_guard<std::mutex> locker(shard.mtx);
+        auto it = shard.index.find(key);
+        if (it != shard.index.end())
+        {
+            shard.lru.erase(it->second);
+            shard.index.erase(it);
+        }
+    }
+
+    size_t Size()
+    {
+        size_t n = 0;
+        for (auto &shard : shards_)
+        {
+            std::lock_guard<std::mutex> locker(shard->mtx);
+            n += shard->index.size();
+        }
+        return n;
+    }
+
+    unsigned long long Hits() const { return hits_; }
+    unsigned long long Misses() const { return misses_; }
+
+private:
+    struct Entry
+    {
+        K key;
+        V value;
+        Clock::time_point expires;
+    };
+
+    struct Shard
+    {
+        explicit Shard(size_t cap) : capacity(cap) {}
+        std::mutex mtx;
+        size_t capacity;
+        std::list<Entry> lru; // 表头为最近使用
+        std::unordered_map<K, typename std::list<Entry>::iterator, Hash> index;
+    };
+
+    Shard &GetShard_(const K &key)
+    {
+        return *shards_[Hash()(key) % shards_.size()];
+    }
+
+    Clock::duration ttl_;
+    std::vector<std::unique_ptr<Shard>> shards_;
+    std::atomic<unsigned long long> hits_;
+    std::atomic<unsigned long long> misses_;
+};
+
+#endif
@@ -0,0 +1,75 @@
+//
+// 请求合并：同一 key 的并发调用只有第一个真正执行，其余调用等待并共享它的结果
+// 用于缓存未命中时的填充（文件映射、凭据查询），避免重启或失效后的惊群
+//
+#ifndef SINGLE_FLIGHT_H
+#define SINGLE_FLIGHT_H
+
+#include <mutex>
+#include <condition_variable>
+#include <memory>
+#include <atomic>
+#include <functional>
+#include <unordered_map>
+
+template <class K, class V, class Hash = std::hash<K>>
+class SingleFlight
+{
+public:
+    SingleFlight() : execs_(0), shared_(0) {}
+
+    // shared 不为空时返回结果是否来自其他调用方
+    V Do(const K &key, const std::function<V()> &fn, bool *shared = nullptr)
+    {
+        std::unique_lock<std::mutex> locker(mtx_);
+        auto it = calls_.find(key);
+        if (it != calls_.end())
+        {
+            std::shared_ptr<Call> call = it->second;
+            call->cond.wait(locker, [&call]
+                            { return call->done; });
+            shared_++;
+            if (shared)
+            {
+                *shared = true;
+            }
+            return call->val;
+        }
+        std::shared_ptr<Call> call = std::make_shared<Call>();
+        calls_.emplace(key, call);
+        locker.unlock();
+
+        V val = fn();
+
+        locker.lock();
+        call->val = val;
+        call->done = true;
+        calls_.erase(key);
+        execs_++;
+        locker.unlock();
+        call->cond.notify_all();
+        if (shared)
+        {
+            *shared = false;
+        }
+        return val;
+    }
+
+    unsigned long long Execs() const { return execs_; }   // 实际执行次数
+    unsigned long long Shared() const { return shared_; } // 共享结果的等待次数
+
+private:
+    struct Call
+    {
+        std::condition_variable cond;
+        bool done = false;
+        V val;
+    };
+
+    std::mutex mtx_;
+    std::unordered_map<K, std::shared_ptr<Call>, Hash> calls_;
+    std::atomic<unsigned long long> execs_;
+    std::atomic<unsigned long long> shared_;
+};
+
+#endif
@@ -0,0 +1,228 @@
+//
+// 用户名存在性索引：64 位指纹的开放寻址哈希表，每个用户 16~32 字节
+// 查表本身就是一两次探测，前面再加布隆过滤器省不下什么，故不设
+// 指纹用进程启动时随机生成密钥的 SipHash-2-4 计算，外部无法构造指纹相同的用户名
+// 启动时从 user 表全量加载，注册成功后增量插入
+//
+#ifndef USER_INDEX_H
+#define USER_INDEX_H
+
+#include <mutex>
+#include <vector>
+#include <string>
+#include <cstdint>
+#include <random>
+
+class UserIndex
+{
+public:
+    struct Stats
+    {
+        size_t users;                      // 已收录的用户名数
+        size_t memoryBytes;                // 指纹表占用
+        double mbPerMillion;               // 每百万用户的内存（MB）
+        unsigned long long queries;
+        unsigned long long taken;          // 直接判定已存在的次数
+        double expectedFpRate;             // 不存在的用户名被误判为已占用的概率，约 users/2^64
+        unsigned long long absentChecks;   // 数据库确认不存在的用户名数
+        unsigned long long falsePositives; // 其中索引误判为已占用的次数
+    };
+
+    explicit UserIndex(size_t expectedUsers = 1 << 16)
+        : count_(0), queries_(0), taken_(0), absentChecks_(0), falsePositives_(0)
+    {
+        std::random_device rd;
+        key0_ = (uint64_t)rd() << 32 | rd();
+        key1_ = (uint64_t)rd() << 32 | rd();
+        Rehash_(expectedUsers);
+    }
+
+    void Add(const std::string &name)
+    {
+        uint64_t fp = Fingerprint_(name);
+        std::lock_guard<std::mutex> locker(mtx_);
+        if ((count_ + 1) * 2 > slots_.size())
+        {
+            Rehash_(slots_.size()); // 负载因子超过 1/2 时扩容
+        }
+        if (Insert_(fp))
+        {
+            count_++;
+        }
+    }
+
+    // 返回 true 表示用户名已被占用（误判概率约 n/2^64，见 Stats）；false 时需查询数据库
+    bool Contains(const std::string &name)
+    {
+        uint64_t fp = Fingerprint_(name);
+        std::lock_guard<std::mutex> locker(mtx_);
+        queries_++;
+        if (!Find_(fp))
+        {
+            return false;
+        }
+        taken_++;
+        return true;
+    }
+
+    // 数据库确认 name 不存在时调用，用于统计实际误判次数
+    void NoteAbsent(const std::string &name)
+    {
+        uint64_t fp = Fingerprint_(name);
+        std::lock_guard<std::mutex> locker(mtx_);
+        absentChecks_++;
+        if (Find_(fp))
+        {
+            falsePositives_++;
+        }
+    }
+
+    Stats GetStats()
+    {
+        std::lock_guard<std::mutex> locker(mtx_);
+        Stats stats{};
+        stats.users = count_;
+        stats.memoryBytes = slots_.size() * sizeof(uint64_t);
+        stats.mbPerMillion = count_ ? stats.memoryBytes * 1e6 / count_ / (1 << 20) : 0;
+        stats.queries = queries_;
+        stats.taken = taken_;
+        stats.expectedFpRate = count_ / 18446744073709551616.0;
+        stats.absentChecks = absentChecks_;
+        stats.falsePositives = falsePositives_;
+        return stats;
+    }
+
+private:
+    static uint64_t Mix_(uint64_t x)
+    {
+        x ^= x >> 33;
+        x *= 0xff51afd7ed558ccdULL;
+        x ^= x >> 33;
+        x *= 0xc4ceb9fe1a85ec53ULL;
+        x ^= x >> 33;
+        return x;
+    }
+
+    static uint64_t Rotl_(uint64_t x, int b)
+    {
+        return (x << b) | (x >> (64 - b));
+    }
+
+    static void SipRound_(uint64_t &v0, uint64_t &v1, uint64_t &v2, uint64_t &v3)
+    {
+        v0 += v1;
+        v1 = Rotl_(v1, 13) ^ v0;
+        v0 = Rotl_(v0, 32);
+        v2 += v3;
+        v3 = Rotl_(v3, 16) ^ v2;
+        v0 += v3;
+        v3 = Rotl_(v3, 21) ^ v0;
+        v2 += v1;
+        v1 = Rotl_(v1, 17) ^ v2;
+        v2 = Rotl_(v2, 32);
+    }
+
+    // SipHash-2-4
+    uint64_t SipHash_(const std::string &data) const
+    {
+        uint64_t v0 = key0_ ^ 0x736f6d6570736575ULL, v1 = key1_ ^ 0x646f72616e646f6dULL;
+        uint64_t v2 = key0_ ^ 0x6c7967656e657261ULL, v3 = key1_ ^ 0x7465646279746573ULL;
+        size_t len = data.size(), i = 0;
+        uint64_t m;
+        for (; i + 8 <= len; i += 8)
+        {
+            m = 0;
+            for (int j = 0; j < 8; j++)
+            {
+                m |= (uint64_t)(unsigned char)data[i + j] << (8 * j);
+            }
+            v3 ^= m;
+            SipRound_(v0, v1, v2, v3);
+            SipRound_(v0, v1, v2, v3);
+            v0 ^= m;
+        }
+        m = (uint64_t)len << 56;
+        for (int j = 0; i + j < len; j++)
+        {
+            m |= (uint64_t)(unsigned char)data[i + j] << (8 * j);
+        }
+        v3 ^= m;
+        SipRound_(v0, v1, v2, v3);
+        SipRound_(v0, v1, v2, v3);
+        v0 ^= m;
+        v2 ^= 0xff;
+        for (int r = 0; r < 4; r++)
+        {
+            SipRound_(v0, v1, v2, v3);
+        }
+        return v0 ^ v1 ^ v2 ^ v3;
+    }
+
+    uint64_t Fingerprint_(const std::string &name) const
+    {
+        uint64_t fp = SipHash_(name);
+        return fp ? fp : 1; // 0 留作空槽
+    }
+
+    bool Insert_(uint64_t fp)
+    {
+        size_t mask = slots_.size() - 1;
+        for (size_t i = Mix_(fp) & mask;; i = (i + 1) & mask)
+        {
+            if (slots_[i] == fp)
+            {
+                return false;
+            }
+            if (slots_[i] == 0)
+            {
+                slots_[i] = fp;
+                return true;
+            }
+        }
+    }
+
+    bool Find_(uint64_t fp) const
+    {
+        size_t mask = slots_.size() - 1;
+        for (size_t i = Mix_(fp) & mask; slots_[i] != 0; i = (i + 1) & mask)
+        {
+            if (slots_[i] == fp)
+            {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    // 按 2 倍容量重建指纹表
+    void Rehash_(size_t users)
+    {
+        size_t cap = 16;
+        while (cap < users * 2)
+        {
+            cap <<= 1;
+        }
+        std::vector<uint64_t> old;
+        old.swap(slots_);
+        slots_.assign(cap, 0);
+        for (uint64_t fp : old)
+        {
+            if (fp)
+            {
+                Insert_(fp);
+            }
+        }
+    }
+
+    uint64_t key0_, key1_; // SipHash 密钥，每个进程随机生成
+    std::mutex mtx_;
+    std::vector<uint64_t> slots_; // 开放寻址（线性探测），0 为空槽
+    size_t count_;
+
+    unsigned long long queries_;
+    unsigned long long taken_;
+    unsigned long long absentChecks_;
+    unsigned long long falsePositives_;
+};
+
+#endif
@@ -5,7 +5,59 @@
 
 const char *HttpConn::srcDir;
 std::atomic<int> HttpConn::userCount;
+std::atomic<bool> HttpConn::isReady(false);
+std::atomic<unsigned long long> HttpConn::requestCount(0);
 bool HttpConn::isET;
+std::atomic<uint64_t> HttpConn::connSeq_(0);
+bool HttpConn::exposeMetrics = true;
+
+namespace
+{
+    // 请求路径上的指标，进程启动时注册一次
+    struct HttpMetrics
+    {
+        MetricCounter *accepted;
+        MetricCounter *closed;
+        MetricCounter *bytesIn;
+        MetricCounter *bytesOut;
+        MetricCounter *requests[6]; // 200、400、403、404、503、其他
+
+        HttpMetrics()
+        {
+            MetricsRegistry *registry = MetricsRegistry::Instance();
+            accepted = registry->Counter("webserver_connections_accepted_total", "Accepted client connections.");
+            closed = registry->Counter("webserver_connections_closed_total", "Closed client connections.");
+            bytesIn = registry->Counter("webserver_http_received_bytes_total", "Bytes read from clients.");
+            bytesOut = registry->Counter("webserver_http_sent_bytes_total", "Bytes written to clients.");
+            const char *codes[] = {"200", "400", "403", "404", "503", "other"};
+            for (int i = 0; i < 6; i++)
+            {
+                requests[i] = registry->Counter("webserver_http_requests_total", "HTTP responses by status code.",
+                                                std::string("code=\"") + codes[i] + "\"");
+            }
+        }
+
+        MetricCounter *Requests(int code)
+        {
+            switch (code)
+            {
+            case 200:
+                return requests[0];
+            case 400:
+                return requests[1];
+            case 403:
+                return requests[2];
+            case 404:
+                return requests[3];
+            case 503:
+                return requests[4];
+            default:
+                return requests[5];
+            }
+        }
+    };
+    HttpMetrics httpMetrics;
+}
 
 int HttpConn::ToWriteBytes()
 {
@@ -17,7 +69,7 @@ bool HttpConn::IsKeepAlive() const
     return request_.IsKeepAlive();
 }
 
-HttpConn::HttpConn() : fd_(-1), addr_({0}), isClose_(true) {};
+HttpConn::HttpConn() : fd_(-1), connId_(0), addr_({0}), isClose_(true), traced_(false), responseBytes_(0), responsePending_(false) {};
 
 HttpConn::~HttpConn()
 {
@@ -30,9 +82,18 @@ void HttpConn::Init(int sockFd, const sockaddr_in &addr)
     userCount++;
     addr_ = addr;
     fd_ = sockFd;
+    connId_ = ++connSeq_;
     writeBuff_.RetrieveAll();
     readBuff_.RetrieveAll();
+    iov_[0].iov_len = iov_[1].iov_len = 0;
+    iovCnt_ = 0;
     isClose_ = false;
+    deadline_ = Deadline();
+    responsePending_ = false;
+    traced_ = RequestTracer::Instance()->IsEnabled() || AccessLog::Instance()->IsOpen();
+    trace_.Clear();
+    TraceMark(RequestTrace::ACCEPT);
+    httpMetrics.accepted->Add();
     LOG_INFO("Client[%d](%s:%d) in, userCount:%d", fd_, GetIp(), GetPort(), (int)userCount);
 }
 
@@ -44,6 +105,7 @@ void HttpConn::Close()
         isClose_ = true;
         userCount--;
         close(fd_);
+        httpMetrics.closed->Add();
         LOG_INFO("Client[%d](%s:%d) quit, UserCount:%d", fd_, GetIp(), GetPort(), (int)userCount);
     }
 }
@@ -78,6 +140,11 @@ ssize_t HttpConn::read(int *saveErrno)
         {
             break;
         }
+        httpMetrics.bytesIn->Add(len);
+        if (traced_)
+        {
+            trace_.MarkOnce(RequestTrace::READ);
+        }
     } while (isET);
     return len;
 }
@@ -94,6 +161,11 @@ ssize_t HttpConn::write(int *saveErrno)
             *saveErrno = errno;
             break;
         }
+        httpMetrics.bytesOut->Add(len);
+        if (traced_)
+        {
+            trace_.MarkOnce(RequestTrace::FIRST_WRITE);
+        }
         if (iov_[0].iov_len + iov_[1].iov_len == 0)
         {
             break;
@@ -115,6 +187,11 @@ ssize_t HttpConn::write(int *saveErrno)
             writeBuff_.Retrieve(len);
         }
     } while (isET || ToWriteBytes() > 10240);
+    if (responsePending_ && ToWriteBytes() == 0)
+    {
+        responsePending_ = false;
+        FinishTrace_();
+    }
     return len;
 }
 
@@ -125,16 +202,66 @@ bool HttpConn::process()
     {
         return false;
     }
-    else if (request_.parse(readBuff_))
+    requestCount++;
+    if (traced_)
     {
-        response_.Init(srcDir, request_.path(), request_.IsKeepAlive(), 200);
+        trace_.MarkOnce(RequestTrace::READ); //流水线中的后续请求没有新的读事件
+    }
+    bool parsed = request_.parse(readBuff_);
+    TraceMark(RequestTrace::PARSED);
+    if (parsed)
+    {
+        if (request_.IsVerifyPending())
+        {
+            return true; // 响应在数据库校验完成后生成
+        }
+        if (request_.path() == "/ready")
+        {
+            response_.Init(srcDir, request_.path(), request_.IsKeepAlive(), isReady ? 200 : 503);
+            response_.SetBody(isReady ? "ready\n" : "starting\n");
+        }
+        else if (request_.path() == "/metrics" && exposeMetrics)
+        {
+            response_.Init(srcDir, request_.path(), request_.IsKeepAlive(), 200);
+            response_.SetBody(MetricsRegistry::Instance()->Render());
+        }
+        else
+        {
+            response_.Init(srcDir, request_.path(), request_.IsKeepAlive(), 200);
+        }
         LOG_DEBUG("%s", request_.path().c_str());
     }
     else
     {
         response_.Init(srcDir, request_.path(), false, 400);
     }
+    MakeResponse_();
+    return true;
+}
+
+bool HttpConn::IsVerifyPending() const
+{
+    return request_.IsVerifyPending();
+}
+
+void HttpConn::FinishVerify(bool ok)
+{
+    request_.SetVerifyResult(ok);
+    TraceMark(RequestTrace::DB_DONE);
+    response_.Init(srcDir, request_.path(), request_.IsKeepAlive(), 200);
+    MakeResponse_();
+}
+
+void HttpConn::RejectVerify()
+{
+    request_.SetVerifyResult(false);
+    TraceMark(RequestTrace::DB_DONE);
+    response_.Init(srcDir, request_.path(), false, 503);
+    MakeResponse_();
+}
 
+void HttpConn::MakeResponse_()
+{
     response_.MaskResponse(writeBuff_);
     iov_[0].iov_base = const_cast<char *>(writeBuff_.Peek());
     iov_[0].iov_len = writeBuff_.ReadableBytes();
@@ -147,5 +274,64 @@ bool HttpConn::process()
         iovCnt_ = 2;
     }
     LOG_DEBUG("filesize:%d, %d  to %d", response_.FileLen(), iovCnt_, ToWriteBytes());
-    return true;
+    httpMetrics.Requests(response_.Code())->Add();
+    if (traced_)
+    {
+        trace_.Mark(RequestTrace::HANDLED);
+        responseBytes_ = ToWriteBytes();
+        responsePending_ = true;
+    }
+}
+
+void HttpConn::TraceDispatch(std::chrono::steady_clock::time_point t)
+{
+    if (!traced_)
+    {
+        return;
+    }
+    int64_t accept = trace_.ts[RequestTrace::ACCEPT];
+    trace_.Clear();
+    trace_.ts[RequestTrace::ACCEPT] = accept;
+    trace_.Set(RequestTrace::DISPATCH, t);
+}
+
+void HttpConn::FinishTrace_()
+{
+    trace_.Mark(RequestTrace::LAST_WRITE);
+    int status = response_.Code();
+    const std::string &path = request_.path();
+    if (RequestTracer::Instance()->IsEnabled())
+    {
+        RequestTracer::Instance()->Finish(trace_, path, status, addr_.sin_addr.s_addr);
+    }
+
+    AccessLog *accessLog = AccessLog::Instance();
+    if (accessLog->IsOpen() && accessLog->Sampled(status))
+    {
+        // 到达时间取第一个经过的阶段（连接建立除外），换算成墙上时间
+        int64_t arrival = trace_.ts[RequestTrace::LAST_WRITE];
+        for (int i = RequestTrace::DISPATCH; i < RequestTrace::LAST_WRITE; i++)
+        {
+            if (trace_.ts[i])
+            {
+                arrival = trace_.ts[i];
+                break;
+            }
+        }
+        AccessLog::Entry entry;
+        entry.timeNs = LogCodec::NowNs() - (trace_.ts[RequestTrace::LAST_WRITE] - arrival);
+        entry.ip = addr_.sin_addr.s_addr;
+        entry.port = ntohs(addr_.sin_port);
+        entry.status = static_cast<uint16_t>(status);
+        entry.bytes = responseBytes_;
+        entry.queueUs = static_cast<uint32_t>(trace_.Us(RequestTrace::DISPATCH, RequestTrace::DEQUEUE));
+        entry.parseUs = static_cast<uint32_t>(trace_.Us(RequestTrace::READ, RequestTrace::PARSED));
+        entry.processUs = static_cast<uint32_t>(trace_.Us(RequestTrace::PARSED, RequestTrace::HANDLED));
+        entry.sendUs = static_cast<uint32_t>(trace_.Us(RequestTrace::HANDLED, RequestTrace::LAST_WRITE));
+        std::string method = request_.method();
+        memset(entry.method, 0, sizeof(entry.method));
+        memcpy(entry.method, method.data(), std::min(method.size(), sizeof(entry.method)));
+        accessLog->Record(entry, path.data(), path.size());
+    }
+    trace_.Clear(); //之后的请求不再计连接建立阶段
 }
\ No newline at end of file
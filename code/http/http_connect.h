@@ -4,7 +4,11 @@
 #include "http_request.h"
 #include "http_response.h"
 #include "../log/log.h"
+#include "../log/access_log.h"
+#include "../metrics/metrics.h"
+#include "../metrics/request_trace.h"
 #include <arpa/inet.h>
+#include <chrono>
 
 class HttpConn
 {
@@ -26,6 +30,23 @@ public:
 
     bool process();
 
+    bool IsVerifyPending() const;  // 请求需要数据库校验，响应尚未生成
+    void FinishVerify(bool ok);    // 数据库校验完成后生成响应
+    void RejectVerify();           // 数据库通道繁忙，返回 503
+    const HttpRequest &GetRequest() const { return request_; }
+    uint64_t GetConnId() const { return connId_; }
+    void SetDeadline(const Deadline &deadline) { deadline_ = deadline; } // 新请求到达时由事件循环设置
+    void TraceDispatch(std::chrono::steady_clock::time_point t); // 同上，开始追踪一个新请求
+    void TraceMark(RequestTrace::PHASE phase)                     // 在事件循环或线程池中经过的阶段
+    {
+        if (traced_)
+        {
+            trace_.Mark(phase);
+        }
+    }
+    const Deadline &GetDeadline() const { return deadline_; }
+    bool IsClosed() const { return isClose_; }
+
     int ToWriteBytes();
 
     bool IsKeepAlive() const;
@@ -33,12 +54,28 @@ public:
     static bool isET;
     static const char *srcDir;
     static std::atomic<int> userCount;
+    static std::atomic<bool> isReady; // 用户存储已就绪，/ready 返回 200
+    static std::atomic<unsigned long long> requestCount; // 已处理的请求数
+    static bool exposeMetrics;                           // 在服务端口上提供 /metrics，使用独立管理端口时关闭
 
 private:
+    void MakeResponse_();
+    void FinishTrace_(); // 响应全部写出后记入阶段直方图，并按抽样写访问日志
+
+    static std::atomic<uint64_t> connSeq_;
+
     int fd_;
+    uint64_t connId_; // 每次 Init 递增，用于识别 fd 复用
     struct sockaddr_in addr_;
 
     bool isClose_;
+    Deadline deadline_; // 当前请求的处理截止时间
+
+    // 请求阶段追踪，访问日志或阶段追踪开启时才取时间戳
+    bool traced_;
+    RequestTrace trace_;
+    size_t responseBytes_;
+    bool responsePending_; // 响应已生成、尚未写完
 
     int iovCnt_{};
 
@@ -12,6 +12,11 @@ const std::unordered_set<std::string> HttpRequest::DEFAULT_HTML{
     "/picture",
 };
 
+HttpRequest::UserCache *HttpRequest::userCache = nullptr;
+UserIndex *HttpRequest::userIndex = nullptr;
+UserStore *HttpRequest::userStore = nullptr;
+SingleFlight<std::string, HttpRequest::Lookup> HttpRequest::lookupFlight_;
+
 const std::unordered_map<std::string, int> HttpRequest::DEFAULT_HTML_TAG{
     {"/register.html", 0},
     {"/login.html", 1},
@@ -61,6 +66,7 @@ void HttpRequest::Init()
 {
     method_ = path_ = version_ = body_ = "";
     state_ = REQUEST_LINE;
+    verifyTag_ = -1;
     header_.clear();
     post_.clear();
 }
@@ -193,7 +199,7 @@ int HttpRequest::ConverHex(char c)
     return c;
 }
 
-// 登陆 注册
+// 登陆 注册：只做标记，数据库校验由服务器分派到数据库通道执行
 void HttpRequest::ParsePost_()
 {
     if (method_ == "POST" && header_["Content-Type"] == "application/x-www-form-urlencoded")
@@ -205,20 +211,19 @@ void HttpRequest::ParsePost_()
             LOG_DEBUG("Tag:%d", tag);
             if (tag == 0 || tag == 1)
             {
-                bool isLogin = (tag == 1);
-                if (UserVerify(post_["username"], post_["password"], isLogin))
-                {
-                    path_ = "/welcome.html";
-                }
-                else
-                {
-                    path_ = "/error.html";
-                }
+                verifyTag_ = tag;
             }
         }
     }
 }
 
+void HttpRequest::SetVerifyResult(bool ok)
+{
+    assert(IsVerifyPending());
+    path_ = ok ? "/welcome.html" : "/error.html";
+    verifyTag_ = -1;
+}
+
 // 解析请求体的内容放入post_
 void HttpRequest::ParseFromUrlencoded_()
 {
@@ -266,77 +271,103 @@ void HttpRequest::ParseFromUrlencoded_()
     }
 }
 
-bool HttpRequest::UserVerify(const std::string &name,
-                             const std::string &pwd,
-                             bool isLogin)
+// 并发的同名查询共享一次结果；借用的结果若因他人的截止时间过期而失败，自己的时间还够就重新查询
+HttpRequest::Lookup HttpRequest::LookupPassword_(const std::string &name, const Deadline &deadline)
 {
-    if (name.empty() || pwd.empty())
+    bool shared = false;
+    Lookup lookup = lookupFlight_.Do(name, [&name, &deadline]
+                                     {
+        Lookup res;
+        res.found = userStore->GetPassword(name, &res.pwd, deadline);
+        return res; }, &shared);
+    if (shared && lookup.found == UserStore::STORE_EXPIRED && !deadline.Expired())
     {
-        return false;
+        lookup.found = userStore->GetPassword(name, &lookup.pwd, deadline);
     }
-    LOG_INFO("Verify name:%s pwd:%s", name.c_str(), pwd.c_str());
-
-    MYSQL *sql = nullptr;
-    SqlConnRAII connRAII(&sql, SqlConnPool::Instance());
-    assert(sql);
-
-    // 防 SQL 注入
-    char escName[128] = {0};
-    char escPwd[128] = {0};
-    mysql_real_escape_string(sql, escName, name.c_str(), name.length());
-    mysql_real_escape_string(sql, escPwd, pwd.c_str(), pwd.length());
-
-    char query[256] = {0};
-    snprintf(query, sizeof(query),
-             "SELECT password FROM user WHERE username='%s' LIMIT 1",
-             escName);
-    LOG_DEBUG("%s", query);
+    return lookup;
+}
 
-    if (mysql_query(sql, query))
+int HttpRequest::UserVerify(const std::string &name,
+                            const std::string &pwd,
+                            bool isLogin,
+                            const Deadline &deadline)
+{
+    if (name.empty() || pwd.empty())
     {
-        return false;
+        return VERIFY_FAIL;
     }
+    LOG_DEBUG("Verify name:%s", name.c_str());
 
-    MYSQL_RES *res = mysql_store_result(sql);
-    if (!res)
+    // 缓存命中时登录直接比对，注册可直接判定用户名已被占用
+    std::string stored;
+    if (userCache && userCache->Get(name, &stored))
     {
-        return false;
+        return isLogin && pwd == stored ? VERIFY_OK : VERIFY_FAIL;
+    }
+    // 已存在的用户名无需访问数据库即可拒绝注册
+    if (!isLogin && userIndex && userIndex->Contains(name))
+    {
+        LOG_DEBUG("user used!");
+        return VERIFY_FAIL;
     }
 
-    MYSQL_ROW row = mysql_fetch_row(res);
-    LOG_DEBUG("MYSQL ROW: %s %s", row[0]);
-    bool userExists = (row != nullptr);
+    if (!userStore)
+    {
+        return VERIFY_FAIL;
+    }
+    Lookup lookup = LookupPassword_(name, deadline);
+    int found = lookup.found;
+    stored = lookup.pwd;
+    if (found < 0)
+    {
+        return found == UserStore::STORE_EXPIRED ? VERIFY_EXPIRED : VERIFY_FAIL;
+    }
+    if (found == 1)
+    {
+        if (userCache)
+        {
+            userCache->Put(name, stored);
+        }
+        if (userIndex)
+        {
+            userIndex->Add(name);
+        }
+    }
+    else if (isLogin && userIndex)
+    {
+        userIndex->NoteAbsent(name); // 登录路径不查索引，用它抽查索引的误判
+    }
 
     // 登录逻辑
     if (isLogin)
     {
-        bool ok = userExists && (pwd == row[0]);
+        bool ok = found == 1 && pwd == stored;
         if (!ok)
         {
             LOG_DEBUG("user not exist or pwd error!");
         }
-        mysql_free_result(res);
-        return ok;
+        return ok ? VERIFY_OK : VERIFY_FAIL;
     }
 
     // 注册逻辑
-    if (userExists)
+    if (found == 1)
     {
-        mysql_free_result(res);
         LOG_DEBUG("user used!");
-        return false; // 用户已存在
+        return VERIFY_FAIL; // 用户已存在
     }
-
-    mysql_free_result(res);
-
-    snprintf(query, sizeof(query),
-             "INSERT INTO user(username,password) VALUES('%s','%s')",
-             escName, escPwd);
-    if (mysql_query(sql, query))
+    int err = userStore->AddUser(name, pwd, deadline);
+    if (err)
     {
-        LOG_DEBUG("Insert error!");
-        return false;
+        return err == UserStore::STORE_EXPIRED ? VERIFY_EXPIRED : VERIFY_FAIL;
+    }
+    if (userCache)
+    {
+        userCache->Put(name, pwd);
+    }
+    if (userIndex)
+    {
+        userIndex->Add(name);
     }
     LOG_DEBUG("UserVerify success!!");
-    return true;
+    return VERIFY_OK;
 }
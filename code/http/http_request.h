@@ -7,9 +7,11 @@
 #include <unordered_map>
 #include <unordered_set>
 #include <string>
-#include <mysql/mysql.h>
 #include "../buffer/buffer.h"
-#include "../pool/sql_connect_RAII.h"
+#include "../store/user_store.h"
+#include "../cache/lru_cache.h"
+#include "../cache/user_index.h"
+#include "../cache/single_flight.h"
 #include "../log/log.h"
 
 class HttpRequest
@@ -50,7 +52,37 @@ public:
 
     bool IsKeepAlive() const; // 判断是否保持长连接
 
+    bool IsVerifyPending() const { return verifyTag_ >= 0; } // 登录/注册请求等待数据库校验
+    bool IsLoginVerify() const { return verifyTag_ == 1; }
+    void SetVerifyResult(bool ok);                           // 根据校验结果设置跳转页面
+
+    enum VERIFY_RESULT
+    {
+        VERIFY_FAIL = 0,
+        VERIFY_OK,
+        VERIFY_EXPIRED, // 截止时间已过，放弃校验
+    };
+
+    // 阻塞访问用户存储，返回 VERIFY_RESULT
+    static int UserVerify(const std::string &name, const std::string &pwd, bool isLogin,
+                          const Deadline &deadline = Deadline());
+
+    typedef LruCache<std::string, std::string> UserCache;
+    static UserCache *userCache; // 用户名 -> 密码，为空表示不缓存
+    static UserIndex *userIndex; // 用户名存在性索引，为空表示注册总是查库
+    static UserStore *userStore; // 用户存储后端
+
+    static unsigned long long LookupExecs() { return lookupFlight_.Execs(); }   // 实际查询存储的次数
+    static unsigned long long LookupShared() { return lookupFlight_.Shared(); } // 合并掉的并发查询次数
+
 private:
+    struct Lookup
+    {
+        int found = UserStore::STORE_ERROR; // GetPassword 的返回值
+        std::string pwd;
+    };
+    static Lookup LookupPassword_(const std::string &name, const Deadline &deadline);
+
     bool ParseRequestLine_(const std::string &line);
     void ParseHeader_(const std::string &line);
     void ParseBody_(const std::string &line);
@@ -59,13 +91,14 @@ private:
     void ParsePost_(); // 判断是否是 POST 请求，并调用表单解析
     void ParseFromUrlencoded_();
 
-    static bool UserVerify(const std::string &name, const std::string &pwd, bool isLogin);
-
     PARSE_STATE state_;
+    int verifyTag_; // -1 无需校验，0 注册，1 登录
     std::string method_, path_, version_, body_;
     std::unordered_map<std::string, std::string> header_; // 所有 HTTP 头字段
     std::unordered_map<std::string, std::string> post_;   // POST 表单键值对
 
+    static SingleFlight<std::string, Lookup> lookupFlight_; // 同一用户名的并发查询只访问一次存储
+
     static const std::unordered_set<std::string> DEFAULT_HTML;          // 页面集合
     static const std::unordered_map<std::string, int> DEFAULT_HTML_TAG; // 页面类型标记
     static int ConverHex(char c);                                       // 十六进制字符转数字
@@ -31,15 +31,19 @@ const std::unordered_map<int, std::string> HttpResponse::CODE_STATUS = {
     {400, "Bad Request"},
     {403, "Forbidden"},
     {404, "Not Found"},
+    {503, "Service Unavailable"},
 };
 
 const std::unordered_map<int, std::string> HttpResponse::CODE_PATH = {
     {400, "/400.html"},
     {403, "/403.html"},
     {404, "/404.html"},
+    {503, "/503.html"},
 };
 
-HttpResponse::HttpResponse() : code_(-1), path_(""), srcDir_(""), isKeepAlive_(false), mmFile_(nullptr), mmFileStat_({0}) {};
+FileCache *HttpResponse::fileCache = nullptr;
+
+HttpResponse::HttpResponse() : code_(-1), path_(""), srcDir_(""), isKeepAlive_(false), mmFile_(nullptr), mmFileStat_({0}), hasBody_(false) {};
 
 HttpResponse::~HttpResponse()
 {
@@ -49,7 +53,7 @@ HttpResponse::~HttpResponse()
 void HttpResponse::Init(const std::string &srcDir, std::string &path, bool isKeepAlive, int code)
 {
     assert(!srcDir.empty());
-    if (mmFile_)
+    if (mmFile_ || file_)
     {
         UnmapFile();
     }
@@ -59,11 +63,27 @@ void HttpResponse::Init(const std::string &srcDir, std::string &path, bool isKee
     srcDir_ = srcDir;
     mmFile_ = nullptr;
     mmFileStat_ = {0};
+    hasBody_ = false;
+    body_.clear();
+}
+
+void HttpResponse::SetBody(const std::string &body)
+{
+    hasBody_ = true;
+    body_ = body;
 }
 
 void HttpResponse::MaskResponse(Buffer &buff)
 {
-    if (stat((srcDir_ + path_).data(), &mmFileStat_) < 0 || S_ISDIR(mmFileStat_.st_mode))
+    if (hasBody_)
+    {
+        AddStateLine_(buff);
+        AddHeader_(buff);
+        buff.Append("Content-length: " + std::to_string(body_.size()) + "\r\n\r\n");
+        buff.Append(body_);
+        return;
+    }
+    if (StatFile_() < 0 || S_ISDIR(mmFileStat_.st_mode))
     {
         code_ = 404;
     }
@@ -83,7 +103,18 @@ void HttpResponse::MaskResponse(Buffer &buff)
 
 char *HttpResponse::File()
 {
-    return mmFile_;
+    return file_ ? file_->data : mmFile_;
+}
+
+int HttpResponse::StatFile_()
+{
+    if (!fileCache)
+    {
+        return stat((srcDir_ + path_).data(), &mmFileStat_);
+    }
+    file_ = fileCache->Get(srcDir_ + path_);
+    mmFileStat_ = file_->st;
+    return file_->err ? -1 : 0;
 }
 
 std::size_t HttpResponse::FileLen() const
@@ -96,7 +127,7 @@ void HttpResponse::ErrorHtml_()
     if (CODE_PATH.count(code_) == 1)
     {
         path_ = CODE_PATH.find(code_)->second;
-        stat((srcDir_ + path_).data(), &mmFileStat_);
+        StatFile_();
     }
 }
 
@@ -129,6 +160,17 @@ void HttpResponse::AddHeader_(Buffer &buff)
 
 void HttpResponse::AddContent_(Buffer &buff)
 {
+    if (fileCache)
+    {
+        if (!file_ || file_->err || (!file_->data && mmFileStat_.st_size > 0))
+        {
+            ErrorContent(buff, "File NotFound!");
+            return;
+        }
+        buff.Append("Content-length: " + std::to_string(mmFileStat_.st_size) + "\r\n\r\n");
+        return;
+    }
+
     int srcFd = open((srcDir_ + path_).data(), O_RDONLY);
     if (srcFd < 0)
     {
@@ -150,6 +192,7 @@ void HttpResponse::AddContent_(Buffer &buff)
 
 void HttpResponse::UnmapFile()
 {
+    file_.reset();
     if (mmFile_)
     {
         munmap(mmFile_, mmFileStat_.st_size);
@@ -4,6 +4,7 @@
 #include "../buffer/buffer.h"
 #include <sys/stat.h> //stat
 #include <unordered_map>
+#include "../cache/file_cache.h"
 #include "../log/log.h"
 
 class HttpResponse
@@ -19,12 +20,16 @@ public:
     std::size_t FileLen() const;
     void ErrorContent(Buffer &buff, std::string message) const; // 错误响应体
     int Code() const { return code_; }
+    void SetBody(const std::string &body); // 直接使用给定响应体，不读文件
+
+    static FileCache *fileCache; // 为空表示每次请求都 stat/open/mmap
 
 private:
     void AddStateLine_(Buffer &buff); // 添加响应行
     void AddHeader_(Buffer &buff);    // 添加响应头
     void AddContent_(Buffer &buff);   // 添加响应体
 
+    int StatFile_();            // stat 当前路径，有文件缓存时同时取得映射
     void ErrorHtml_();          // 响应返回到错误页
     std::string GetFileType_(); // 判断文件类型
 
@@ -36,6 +41,9 @@ private:
 
     char *mmFile_;
     struct stat mmFileStat_;
+    FileCache::FilePtr file_; // 来自文件缓存的共享映射
+    bool hasBody_;
+    std::string body_;
 
     static const std::unordered_map<std::string, std::string> SUFFIX_TYPE; // 后缀类型
     static const std::unordered_map<int, std::string> CODE_STATUS;         // 响应码对应状态
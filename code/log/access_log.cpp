@@ -0,0 +1,222 @@
+#include "access_log.h"
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <arpa/inet.h>
+#include "log_time.h"
+
+namespace
+{
+    // 抽样用的线程私有 xorshift 随机数，不需要密码学强度
+    thread_local uint64_t sampleSeed = 0;
+
+    uint32_t NextRandom()
+    {
+        uint64_t x = sampleSeed;
+        if (x == 0)
+        {
+            x = (static_cast<uint64_t>(LogTime::CoarseSteady().time_since_epoch().count()) ^
+                 reinterpret_cast<uintptr_t>(&sampleSeed)) | 1;
+        }
+        x ^= x >> 12;
+        x ^= x << 25;
+        x ^= x >> 27;
+        sampleSeed = x;
+        return static_cast<uint32_t>((x * 0x2545F4914F6CDD1DULL) >> 32);
+    }
+
+    // JSON 字符串转义：引号、反斜杠、控制字符和非 ASCII 字节一律转成 \u00XX
+    size_t EscapeJson(char *out, const char *s, size_t len)
+    {
+        static const char HEX[] = "0123456789abcdef";
+        size_t n = 0;
+        for (size_t i = 0; i < len; i++)
+        {
+            unsigned char c = static_cast<unsigned char>(s[i]);
+            if (c == '"' || c == '\\')
+            {
+                out[n++] = '\\';
+                out[n++] = static_cast<char>(c);
+            }
+            else if (c < 0x20 || c >= 0x7f)
+            {
+                out[n++] = '\\';
+                out[n++] = 'u';
+                out[n++] = '0';
+                out[n++] = '0';
+                out[n++] = HEX[c >> 4];
+                out[n++] = HEX[c & 0xf];
+            }
+            else
+            {
+                out[n++] = static_cast<char>(c);
+            }
+        }
+        return n;
+    }
+}
+
+AccessLog *AccessLog::Instance()
+{
+    static AccessLog accessLog;
+    return &accessLog;
+}
+
+AccessLog::AccessLog()
+    : isOpen_(false), path_(nullptr), ringCapacity_(0), file_(64 * 1024, FLUSH_INTERVAL_MS, MAX_FILE_BYTES),
+      backend_(FLUSH_INTERVAL_MS / 2, WAKE_FRACTION), records_(0), dropped_(0)
+{
+    // 默认：成功和重定向抽 1%，客户端和服务端错误全记
+    rate_[0] = RATE_ONE;
+    rate_[1] = RATE_ONE / 100;
+    rate_[2] = RATE_ONE / 100;
+    rate_[3] = RATE_ONE / 100;
+    rate_[4] = RATE_ONE;
+    rate_[5] = RATE_ONE;
+}
+
+AccessLog::~AccessLog()
+{
+    backend_.Stop();
+    std::lock_guard<std::mutex> locker(fileMtx_);
+    file_.Close();
+}
+
+void AccessLog::Init(const char *path, size_t ringCapacity)
+{
+    if (isOpen_)
+    {
+        return;
+    }
+    path_ = path;
+    ringCapacity_ = ringCapacity;
+    {
+        std::lock_guard<std::mutex> locker(fileMtx_);
+        file_.Open(path_, "access_", ".jsonl", time(nullptr));
+    }
+    backend_.Start(ringCapacity_, [this](const std::vector<LogRing *> &rings, bool closing)
+                   { return WriteRound_(rings, closing); });
+    isOpen_ = true;
+}
+
+void AccessLog::SetSampleRate(int statusClass, double rate)
+{
+    if (statusClass <= 0 || statusClass >= CLASS_COUNT)
+    {
+        return;
+    }
+    rate = rate < 0 ? 0 : (rate > 1 ? 1 : rate);
+    rate_[statusClass].store(static_cast<uint32_t>(rate * RATE_ONE + 0.5), std::memory_order_relaxed);
+}
+
+bool AccessLog::SetSampleRates(const char *spec)
+{
+    bool ok = true;
+    std::string items(spec);
+    size_t start = 0;
+    while (start < items.size())
+    {
+        size_t end = items.find(',', start);
+        if (end == std::string::npos)
+        {
+            end = items.size();
+        }
+        std::string item = items.substr(start, end - start);
+        //形如 "2xx=0.01"
+        if (item.size() > 4 && item[0] >= '1' && item[0] <= '5' && item.compare(1, 3, "xx=") == 0)
+        {
+            SetSampleRate(item[0] - '0', atof(item.c_str() + 4));
+        }
+        else
+        {
+            ok = false;
+        }
+        start = end + 1;
+    }
+    return ok;
+}
+
+bool AccessLog::Sampled(int status)
+{
+    int statusClass = status / 100;
+    if (statusClass <= 0 || statusClass >= CLASS_COUNT)
+    {
+        statusClass = 0;
+    }
+    uint32_t rate = rate_[statusClass].load(std::memory_order_relaxed);
+    if (rate == 0)
+    {
+        return false;
+    }
+    return rate >= RATE_ONE || NextRandom() % RATE_ONE < rate;
+}
+
+void AccessLog::Record(const Entry &entry, const char *path, size_t pathLen)
+{
+    if (!IsOpen())
+    {
+        return;
+    }
+    if (pathLen > PATH_MAX_LEN)
+    {
+        pathLen = PATH_MAX_LEN;
+    }
+    LogRing *ring = backend_.LocalRing();
+    char *dst = ring->Reserve(sizeof(Entry) + pathLen);
+    if (dst == nullptr)
+    {
+        dropped_.fetch_add(1, std::memory_order_relaxed);
+        return;
+    }
+    memcpy(dst, &entry, sizeof(Entry));
+    memcpy(dst + sizeof(Entry), path, pathLen);
+    ring->Commit(sizeof(Entry) + pathLen);
+    backend_.WakeIfBacklogged(ring);
+}
+
+void AccessLog::AppendJson_(const char *data, size_t len)
+{
+    if (len < sizeof(Entry) || !file_.IsOpen())
+    {
+        return;
+    }
+    Entry e;
+    memcpy(&e, data, sizeof(Entry));
+    char ts[LogTime::LEN];
+    LogTime::Format(e.timeNs, ts);
+    ts[10] = 'T';
+    char ip[INET_ADDRSTRLEN];
+    struct in_addr addr;
+    addr.s_addr = e.ip;
+    inet_ntop(AF_INET, &addr, ip, sizeof(ip));
+
+    char *out = file_.BeginWrite(LINE_MAX_LEN);
+    int n = snprintf(out, LINE_MAX_LEN, "{\"ts\":\"%.*s\",\"client\":\"%s:%u\",\"method\":\"",
+                     LogTime::LEN, ts, ip, static_cast<unsigned>(e.port));
+    n += static_cast<int>(EscapeJson(out + n, e.method, strnlen(e.method, sizeof(e.method))));
+    memcpy(out + n, "\",\"path\":\"", 10);
+    n += 10;
+    n += static_cast<int>(EscapeJson(out + n, data + sizeof(Entry), len - sizeof(Entry)));
+    n += snprintf(out + n, LINE_MAX_LEN - n,
+                  "\",\"status\":%u,\"bytes\":%llu,\"queue_us\":%u,\"parse_us\":%u,\"process_us\":%u,\"send_us\":%u}\n",
+                  static_cast<unsigned>(e.status), static_cast<unsigned long long>(e.bytes),
+                  e.queueUs, e.parseUs, e.processUs, e.sendUs);
+    file_.HasWritten(n);
+    records_.fetch_add(1, std::memory_order_relaxed);
+}
+
+size_t AccessLog::WriteRound_(const std::vector<LogRing *> &rings, bool closing)
+{
+    size_t records = 0;
+    std::lock_guard<std::mutex> locker(fileMtx_);
+    for (LogRing *ring : rings)
+    {
+        records += ring->Drain([this](const char *data, size_t len, uint32_t) { AppendJson_(data, len); });
+    }
+    if (!file_.RotateIfNeeded(LogTime::CoarseSeconds()) && (closing || file_.FlushDue(LogTime::CoarseSteady())))
+    {
+        file_.Flush();
+    }
+    return records;
+}
@@ -0,0 +1,78 @@
+//
+// 访问日志：每个请求一条定长记录，按状态码类别抽样，
+// 调用线程只把记录拷进自己的无锁环形缓冲区，后台线程格式化成 JSON Lines 写出
+//
+#ifndef ACCESS_LOG_H
+#define ACCESS_LOG_H
+
+#include <atomic>
+#include <mutex>
+#include <vector>
+#include <cstdint>
+#include "log_file.h"
+#include "log_backend.h"
+
+class AccessLog
+{
+public:
+    struct Entry
+    {
+        int64_t timeNs;    // 请求到达的墙上时间
+        uint32_t ip;       // 网络字节序
+        uint16_t port;
+        uint16_t status;
+        uint64_t bytes;    // 响应头 + 文件
+        uint32_t queueUs;  // 读事件到工作线程开始处理
+        uint32_t parseUs;  // 解析请求
+        uint32_t processUs; // 解析完到响应生成（含数据库校验）
+        uint32_t sendUs;   // 响应生成到全部写出
+        char method[8];
+    };
+
+    static AccessLog *Instance();
+
+    // 在 path 目录下按天写 access_YYYY_MM_DD.jsonl，ringCapacity 为每个线程的缓冲区字节数
+    void Init(const char *path, size_t ringCapacity = 64 * 1024);
+    bool IsOpen() const { return isOpen_.load(std::memory_order_relaxed); }
+
+    // 按状态码类别（1xx~5xx）设置抽样比例，取值 0~1
+    void SetSampleRate(int statusClass, double rate);
+    bool SetSampleRates(const char *spec); // 解析 "2xx=0.01,5xx=1" 形式的配置
+    bool Sampled(int status);              // 是否记录这个请求
+
+    // 缓冲区满时丢弃并计数，不阻塞请求
+    void Record(const Entry &entry, const char *path, size_t pathLen);
+
+    unsigned long long Records() const { return records_.load(std::memory_order_relaxed); }
+    unsigned long long Dropped() const { return dropped_.load(std::memory_order_relaxed); }
+
+private:
+    AccessLog();
+    ~AccessLog();
+
+    void AppendJson_(const char *data, size_t len); // 需持有 fileMtx_
+    size_t WriteRound_(const std::vector<LogRing *> &rings, bool closing); // 后台线程：取空各线程缓冲区并写出
+
+    static const int CLASS_COUNT = 6;     // 下标为状态码百位，0 不用
+    static const uint32_t RATE_ONE = 1000000; // 抽样比例按百万分之一计
+    static const size_t PATH_MAX_LEN = 1024;  // 更长的路径截断
+    static const size_t LINE_MAX_LEN = PATH_MAX_LEN * 6 + 512; // 转义后路径最长 6 倍
+    static const size_t MAX_FILE_BYTES = 256 * 1024 * 1024;
+    static const int FLUSH_INTERVAL_MS = 200;
+    static const int WAKE_FRACTION = 2; // 缓冲区用掉一半时唤醒后台线程
+
+    std::atomic<bool> isOpen_;
+    std::atomic<uint32_t> rate_[CLASS_COUNT];
+    const char *path_;
+    size_t ringCapacity_;
+
+    std::mutex fileMtx_;
+    RotatingLogFile file_;
+
+    LogBackend backend_;
+
+    std::atomic<unsigned long long> records_;
+    std::atomic<unsigned long long> dropped_;
+};
+
+#endif
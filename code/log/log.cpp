@@ -1,204 +1,295 @@
 #include "log.h"
+#include <cstdlib>
 
-Log::Log()
+const int Log::BACKEND_IDLE_MS;
+
+const char *Log::MODULE_NAME[MODULE_COUNT] = {"other", "http", "server", "pool", "timer"};
+std::atomic<int> Log::moduleLevel_[MODULE_COUNT] = {{LEVEL_OFF}, {LEVEL_OFF}, {LEVEL_OFF}, {LEVEL_OFF}, {LEVEL_OFF}};
+
+Log::Log() : file_(FLUSH_BYTES * 2, FLUSH_INTERVAL_MS, MAX_FILE_BYTES), backend_(BACKEND_IDLE_MS, WAKE_FRACTION)
 {
-    lineCount_ = 0;
+    isOpen_ = false;
     isAsync_ = false;
-    writeThread_ = nullptr;
-    deque_ = nullptr;
-    toDay_ = 0;
-    fp_ = nullptr;
+    policy_ = LOG_BLOCK;
+    format_ = LOG_FORMAT_TEXT;
+    ringCapacity_ = 0;
+    syncOnError_ = true;
+    syncPending_ = false;
+    lines_ = 0;
+    dropped_ = 0;
 }
 
 Log::~Log()
 {
-    if (writeThread_ && writeThread_->joinable())
-    {
-        while (!deque_->empty())
-        {
-            deque_->flush();    
-        }
-        deque_->Close();    //pop()返回false,线程退出循环
-        writeThread_->join();   //当前线程（主线程）阻塞等待日志写线程执行完毕
-    }
-    if (fp_)
+    backend_.Stop();
+    std::lock_guard<std::mutex> locker(fileMtx_);
+    file_.Close();
+}
+
+void Log::SetLevel(int level)
+{
+    for (int i = 0; i < MODULE_COUNT; i++)
     {
-        std::lock_guard<std::mutex> locker(mtx_);
-        flush();
-        fclose(fp_);
+        SetModuleLevel(i, level);
     }
 }
 
-int Log::GetLevel()
+bool Log::SetModuleLevel(const char *name, int level)
 {
-    std::lock_guard<std::mutex> locker(mtx_);
-    return level_;
+    for (int i = 0; i < MODULE_COUNT; i++)
+    {
+        if (strcmp(name, MODULE_NAME[i]) == 0)
+        {
+            SetModuleLevel(i, level);
+            return true;
+        }
+    }
+    return false;
 }
 
-void Log::SetLevel(int level)
+bool Log::SetLevels(const char *spec)
 {
-    std::lock_guard<std::mutex> locker(mtx_);
-    level_ = level;
+    bool ok = true;
+    std::string items(spec);
+    size_t start = 0;
+    while (start < items.size())
+    {
+        size_t end = items.find(',', start);
+        if (end == std::string::npos)
+        {
+            end = items.size();
+        }
+        std::string item = items.substr(start, end - start);
+        size_t eq = item.find('=');
+        if (eq == std::string::npos || eq + 1 >= item.size() || !SetModuleLevel(item.substr(0, eq).c_str(), atoi(item.c_str() + eq + 1)))
+        {
+            ok = false;
+        }
+        start = end + 1;
+    }
+    return ok;
 }
 
-void Log::init(int level = 1, const char *path, const char *suffix, int maxDequeSize)
+void Log::init(int level = 1, const char *path, const char *suffix, int maxDequeSize, OVERFLOW_POLICY policy,
+               LOG_FORMAT format)
 {
     isOpen_ = true;
-    level_ = level;
+    SetLevel(level);
+    policy_ = policy;
+    format_ = format;
     if (maxDequeSize > 0)
     {
         isAsync_ = true;
-        if (!deque_)
-        {
-            std::unique_ptr<BlockDeque<std::string>> newDeque(new BlockDeque<std::string>);
-            deque_ = std::move(newDeque);
-
-            std::unique_ptr<std::thread> newThread(new std::thread(FlushLogThread));
-            writeThread_ = std::move(newThread);
-        }
+        // 环形缓冲区至少要能放下两条最长的行
+        ringCapacity_ = std::max(static_cast<size_t>(maxDequeSize) * LINE_AVG_LEN,
+                                 static_cast<size_t>(LINE_MAX_LEN) * 4);
+        backend_.Start(ringCapacity_, [this](const std::vector<LogRing *> &rings, bool closing)
+                       { return WriteRound_(rings, closing); });
     }
     else
     {
         isAsync_ = false;
+        format_ = LOG_FORMAT_TEXT; //二进制记录依赖后台线程
     }
 
-    lineCount_ = 0;
-
-    time_t timer = time(nullptr);   //获得当前时间戳
-    struct tm *sysTime = localtime(&timer); //转换为本地时间结构
-    struct tm t = *sysTime;
     path_ = path;
     suffix_ = suffix;
-    char fileName[LOG_NAME_LEN] = {0};
-    snprintf(fileName, LOG_NAME_LEN - 1, "%s/%04d_%02d_%02d%s",
-             path_, t.tm_year + 1900, t.tm_mon + 1, t.tm_mday, suffix_);
-    toDay_ = t.tm_mday;
 
+    std::lock_guard<std::mutex> locker(fileMtx_);
+    file_.Open(path_, "", suffix_, time(nullptr));
+    FileOpened_();
+}
+
+void Log::FileOpened_()
+{
+    assert(file_.IsOpen());
+    if (format_ == LOG_FORMAT_BINARY)
     {
-        std::lock_guard<std::mutex> locker(mtx_);
-        buff_.RetrieveAll();
-        if (fp_)
-        {
-            flush();
-            fclose(fp_);
-        }
-        fp_ = fopen(fileName, "a"); //追加
-        if (fp_ == nullptr)
-        {
-            mkdir(path_, 0777); //所有用户都可读/写/执行
-            fp_ = fopen(fileName, "a");
-        }
-        assert(fp_ != nullptr);
+        file_.Append("H", 1);
+        file_.Append(LogCodec::FILE_MAGIC, LogCodec::FILE_MAGIC_LEN);
+    }
+    dictWritten_.assign(dictWritten_.size(), false); //新文件需要重新写出格式字典
+}
+
+void Log::RotateIfNeeded_(time_t now)
+{
+    if (file_.RotateIfNeeded(now))
+    {
+        FileOpened_();
     }
 }
 
 void Log::write(int level, const char *format, ...)
 {
-    struct timeval now = {0, 0};    //{秒，微秒}
-    gettimeofday(&now, nullptr);    //获取当前时间
-    time_t tSec = now.tv_sec;
-    struct tm *sysTime = localtime(&tSec);  //localtime() 只能处理 time_t（秒级时间戳）
-    struct tm t = *sysTime;
     va_list vaList;
-
-    //如果日志日期不是当天或者日志超过最大行数，创建一个新的日志文件
-    if (toDay_ != t.tm_mday || (lineCount_ && (lineCount_ % MAX_LINES == 0)))
+    if (isAsync_) //异步：格式化进本线程的环形缓冲区，不加锁
     {
-        std::unique_lock<std::mutex> locker(mtx_);
-        locker.unlock();
-
-        char newFile[LOG_NAME_LEN];
-        char tail[36] = {0};
-        snprintf(tail, 36, "%04d_%02d_%02d", t.tm_year + 1900, t.tm_mon + 1, t.tm_mday);
-
-        if (toDay_ != t.tm_mday)
+        char *dst = ReserveRecord_(LINE_MAX_LEN);
+        if (dst == nullptr)
         {
-            snprintf(newFile, LOG_NAME_LEN - 72, "%s/%s%s", path_, tail, suffix_);
-            toDay_ = t.tm_mday;
-            lineCount_ = 0;
-        }
-        else
-        {
-            snprintf(newFile, LOG_NAME_LEN - 72, "%s/%s-%d%s", path_, tail, (lineCount_ / MAX_LINES), suffix_);
+            return;
         }
-
-        locker.lock();
-        flush();
-        fclose(fp_);
-        fp_ = fopen(newFile, "a");
-        assert(fp_ != nullptr);
+        va_start(vaList, format);
+        int len = FormatLine_(dst, LINE_MAX_LEN, level, format, vaList);
+        va_end(vaList);
+        CommitRecord_(len, RECORD_TEXT | level << TAG_LEVEL_SHIFT);
+        return;
     }
 
-    {
-        std::unique_lock<std::mutex> locker(mtx_);
-        lineCount_++;
-
-        int n = snprintf(buff_.BeginWrite(), 128, "%d-%02d-%02d %02d:%02d:%02d.%06ld ",
-                         t.tm_year + 1900, t.tm_mon + 1, t.tm_mday,
-                         t.tm_hour, t.tm_min, t.tm_sec, now.tv_usec);
-        buff_.HasWritten(n);
+    //同步：每行直接 write，不经过 stdio
+    char line[LINE_MAX_LEN];
+    va_start(vaList, format);
+    int len = FormatLine_(line, sizeof(line), level, format, vaList);
+    va_end(vaList);
 
-        AppendLogLevelTitle_(level);
+    std::lock_guard<std::mutex> locker(fileMtx_);
+    RotateIfNeeded_(LogTime::CoarseSeconds());
+    file_.Append(line, len);
+    lines_.fetch_add(1, std::memory_order_relaxed);
+    if (level >= SYNC_LEVEL && syncOnError_)
+    {
+        file_.Sync();
+    }
+    else
+    {
+        file_.Flush();
+    }
+}
 
-        va_start(vaList, format);   //初始化vaList
-        int m = vsnprintf(buff_.BeginWrite(), buff_.WriteableBytes(), format, vaList);  //将vaList中的参数以format格式写入缓冲区
-        va_end(vaList); //释放vaList相关资源
+int Log::FormatLine_(char *dst, size_t size, int level, const char *format, va_list vaList)
+{
+    int n = LogCodec::FormatPrefix(LogCodec::NowNs(), level, dst);
 
-        buff_.HasWritten(m);
-        buff_.Append("\n\0", 2);
+    size_t room = size - n - 1; //留一个字节给换行
+    int m = vsnprintf(dst + n, room, format, vaList);
+    if (m < 0)
+    {
+        m = 0;
+    }
+    else if (static_cast<size_t>(m) >= room) //超长截断
+    {
+        m = room - 1;
+    }
+    dst[n + m] = '\n';
+    return n + m + 1;
+}
 
-        if (isAsync_ && deque_ && !deque_->full())  //异步
-        {
-            deque_->push_back(buff_.RetrieveAllToStr());
-            return;
-        }
-        else    //同步
+char *Log::ReserveRecord_(size_t len)
+{
+    if (len > static_cast<size_t>(LINE_MAX_LEN))
+    {
+        dropped_.fetch_add(1, std::memory_order_relaxed);
+        return nullptr;
+    }
+    LogRing *ring = backend_.LocalRing();
+    char *dst = ring->Reserve(len);
+    while (dst == nullptr)
+    {
+        if (policy_ == LOG_DROP || backend_.IsClosing())
         {
-            fputs(buff_.Peek(), fp_);   //将缓冲区内容追加写入文件，遇到\0停止，先写到 FILE 缓冲区（用户态），不保证写到磁盘
+            dropped_.fetch_add(1, std::memory_order_relaxed);
+            return nullptr;
         }
-        buff_.RetrieveAll();
+        backend_.WaitForSpace(1);
+        dst = ring->Reserve(len);
     }
+    return dst;
 }
 
-void Log::AppendLogLevelTitle_(int level)
+void Log::CommitRecord_(size_t len, uint32_t tag)
 {
-    switch (level)
+    backend_.CurrentRing()->Commit(len, tag);
+    if (static_cast<int>(tag >> TAG_LEVEL_SHIFT) >= SYNC_LEVEL && syncOnError_)
     {
-    case 0:
-        buff_.Append("[debug]: ", 9);
-        break;
-    case 1:
-        buff_.Append("[info]: ", 8);
-        break;
-    case 2:
-        buff_.Append("[warn]: ", 8);
-        break;
-    case 3:
-        buff_.Append("[error]: ", 9);
-        break;
-    default:
-        buff_.Append("[info]: ", 8);
-        break;
+        backend_.Wake(); //ERROR 行不等刷新周期
     }
 }
 
 void Log::flush()
 {
-    if (isAsync_)
+    if (!isAsync_)
+    {
+        return; //同步模式每行已经写出
+    }
+    backend_.WakeIfBacklogged(backend_.CurrentRing());
+}
+
+void Log::AppendRecord_(const char *data, size_t len, uint32_t tag)
+{
+    if (file_.Full())
+    {
+        RotateIfNeeded_(LogTime::CoarseSeconds());
+    }
+    lines_.fetch_add(1, std::memory_order_relaxed);
+    if (static_cast<int>(tag >> TAG_LEVEL_SHIFT) >= SYNC_LEVEL && syncOnError_)
+    {
+        syncPending_ = true;
+    }
+
+    LOG_FORMAT format = format_;
+    uint32_t type = tag & ((1u << TAG_LEVEL_SHIFT) - 1);
+    if (type == RECORD_TEXT && format != LOG_FORMAT_BINARY)
     {
-        deque_->flush();
+        file_.Append(data, len);
+        return;
     }
-    fflush(fp_);    //强制把用户态缓冲区中的日志数据立即写入到文件（内核态）
+    if (type == RECORD_TEXT) //切换到二进制模式前留下的文本行
+    {
+        uint32_t n = static_cast<uint32_t>(len);
+        file_.Append("T", 1);
+        file_.Append(reinterpret_cast<const char *>(&n), 4);
+        file_.Append(data, len);
+        return;
+    }
+
+    uint32_t id, argLen;
+    int64_t ns;
+    LogCodec::GetEventHeader(data, id, argLen, ns);
+    LogRegistry::Entry entry;
+    if (!LogRegistry::Get(id, entry))
+    {
+        return;
+    }
+    if (format == LOG_FORMAT_BINARY)
+    {
+        if (id >= dictWritten_.size())
+        {
+            dictWritten_.resize(id + 1, false);
+        }
+        if (!dictWritten_[id])
+        {
+            Buffer dict(256);
+            LogCodec::AppendFormat(dict, id, entry);
+            file_.Append(dict.Peek(), dict.ReadableBytes());
+            dictWritten_[id] = true;
+        }
+        file_.Append("E", 1);
+        file_.Append(data, len);
+        return;
+    }
+    char *dst = file_.BeginWrite(LINE_MAX_LEN);
+    file_.HasWritten(LogCodec::FormatEvent(entry, ns, data + LogCodec::EVENT_HEADER, argLen, dst, LINE_MAX_LEN));
 }
 
-void Log::AsyncWrite_()
+size_t Log::WriteRound_(const std::vector<LogRing *> &rings, bool closing)
 {
-    std::string str = "";
-    while (deque_->pop(str))
+    size_t lines = 0;
+    std::lock_guard<std::mutex> locker(fileMtx_);
+    for (LogRing *ring : rings)
     {
-        std::lock_guard<std::mutex> locker(mtx_);
-        fputs(str.c_str(), fp_);
+        lines += ring->Drain([this](const char *data, size_t len, uint32_t tag) { AppendRecord_(data, len, tag); });
     }
+    RotateIfNeeded_(LogTime::CoarseSeconds()); //跨天只在这里检查，不必每行调用 localtime
+    if (syncPending_)
+    {
+        file_.Sync();
+        syncPending_ = false;
+    }
+    else if (closing || file_.FlushDue(LogTime::CoarseSteady()))
+    {
+        file_.Flush();
+    }
+    return lines;
 }
 
 Log *Log::Instance()
@@ -206,8 +297,3 @@ Log *Log::Instance()
     static Log log;
     return &log;
 }
-
-void Log::FlushLogThread()
-{
-    Log::Instance()->AsyncWrite_();
-}
\ No newline at end of file
@@ -9,60 +9,167 @@
 #include <stdarg.h> // vastart va_end
 #include <assert.h>
 #include <sys/stat.h> //mkdir
-#include "blockDeque.h"
+#include <atomic>
+#include <vector>
+#include <memory>
+#include <condition_variable>
+#include <chrono>
+#include <algorithm>
+#include "log_codec.h"
+#include "log_file.h"
+#include "log_backend.h"
 #include "../buffer/buffer.h"
 
+// 编译期最低级别，由 CMake 选项 LOG_MIN_LEVEL 传入，低于它的 LOG_* 语句不会生成代码
+#ifndef LOG_MIN_LEVEL
+#define LOG_MIN_LEVEL 0
+#endif
+
+// 所属模块，由各模块的 CMake 目标定义，用于分模块调整级别
+#ifndef LOG_MODULE
+#define LOG_MODULE Log::MODULE_OTHER
+#endif
+
 class Log
 {
 public:
-    void init(int level, const char *path = "./log", const char *suffix = ".log", int maxDequeCapacity = 1024);
+    enum MODULE
+    {
+        MODULE_OTHER = 0,
+        MODULE_HTTP,
+        MODULE_SERVER,
+        MODULE_POOL,
+        MODULE_TIMER,
+        MODULE_COUNT,
+    };
+    static const int LEVEL_OFF = 4; // 高于所有级别：不输出
+
+    enum OVERFLOW_POLICY // 异步模式下本线程环形缓冲区写满时的处理
+    {
+        LOG_BLOCK = 0, // 等待后台线程腾出空间
+        LOG_DROP,      // 丢弃并计数
+    };
+
+    enum LOG_FORMAT // 异步模式下调用点记录的形式，同步模式总是文本
+    {
+        LOG_FORMAT_TEXT = 0, // 调用线程格式化成文本
+        LOG_FORMAT_DEFERRED, // 调用线程只记录格式 id 和原始参数，后台线程格式化成文本
+        LOG_FORMAT_BINARY,   // 同上，后台线程直接写二进制文件，用 log_decode 转成文本
+    };
+
+    // maxDequeCapacity > 0 启用异步，每个写日志线程的环形缓冲区约可容纳这么多行
+    void init(int level, const char *path = "./log", const char *suffix = ".log", int maxDequeCapacity = 1024,
+              OVERFLOW_POLICY policy = LOG_BLOCK, LOG_FORMAT format = LOG_FORMAT_TEXT);
 
     static Log *Instance();
-    static void FlushLogThread();
 
     void write(int level, const char *format, ...);
     void flush();
 
-    int GetLevel();
-    void SetLevel(int level);
+    // LOG_BASE 的入口：按当前模式格式化或记录原始参数
+    template <class... Args>
+    void Write(LogSite &site, Args... args) // 按值传参，避免 static const 成员被 ODR 使用
+    {
+        if (!isAsync_ || format_ == LOG_FORMAT_TEXT)
+        {
+            write(site.level, site.format, args...);
+            return;
+        }
+        uint32_t id = site.id.load(std::memory_order_acquire);
+        if (id == 0)
+        {
+            id = LogRegistry::Register(site, logarg::Types<Args...>::value);
+        }
+        size_t argLen = logarg::Size(args...);
+        char *dst = ReserveRecord_(LogCodec::EVENT_HEADER + argLen);
+        if (dst == nullptr)
+        {
+            return;
+        }
+        LogCodec::PutEventHeader(dst, id, static_cast<uint32_t>(argLen), LogCodec::NowNs());
+        logarg::Encode(dst + LogCodec::EVENT_HEADER, args...);
+        CommitRecord_(LogCodec::EVENT_HEADER + argLen, RECORD_EVENT | site.level << TAG_LEVEL_SHIFT);
+    }
+
+    int GetLevel(int module = MODULE_OTHER) const { return moduleLevel_[module].load(std::memory_order_relaxed); }
+    void SetLevel(int level); // 设置所有模块
+    void SetModuleLevel(int module, int level) { moduleLevel_[module].store(level, std::memory_order_relaxed); }
+    bool SetModuleLevel(const char *name, int level); // 按模块名设置，未知模块返回 false
+    bool SetLevels(const char *spec);                 // 解析 "http=0,server=2" 形式的配置
     bool isOpen() { return isOpen_; }
 
+    static constexpr bool Compiled(int level) { return level >= LOG_MIN_LEVEL; }
+    // 运行期级别检查：一次 relaxed 读取和一次比较，不取 Instance()
+    static bool Enabled(int level, int module)
+    {
+        return level >= moduleLevel_[module].load(std::memory_order_relaxed);
+    }
+    void SetSyncOnError(bool on) { syncOnError_ = on; } // ERROR 行写出后 fdatasync，默认开启
+    unsigned long long Dropped() const { return dropped_.load(std::memory_order_relaxed); } // 缓冲区满被丢弃的行数
+    unsigned long long Lines() const { return lines_.load(std::memory_order_relaxed); }     // 已写入文件的行数
+    unsigned long long FileWrites() const { return file_.Writes(); }                        // write 系统调用次数
+    unsigned long long FileSyncs() const { return file_.Syncs(); }
+
 private:
     Log();
-    void AppendLogLevelTitle_(int level);
+    int FormatLine_(char *dst, size_t size, int level, const char *format, va_list vaList); // 返回行长度（含换行）
+    char *ReserveRecord_(size_t len);                   // 在本线程缓冲区预留空间，按溢出策略等待或丢弃
+    void CommitRecord_(size_t len, uint32_t tag);       // 提交 ReserveRecord_ 预留的记录
+    void AppendRecord_(const char *data, size_t len, uint32_t tag); // 后台线程：追加到文件缓冲，需持有 fileMtx_
+    void FileOpened_();                                 // 新文件打开后写文件头、重置格式字典，需持有 fileMtx_
+    void RotateIfNeeded_(time_t now);                   // 跨天或文件超过大小上限时切换，需持有 fileMtx_
+    size_t WriteRound_(const std::vector<LogRing *> &rings, bool closing); // 后台线程：取空各线程缓冲区并写出
     virtual ~Log();
-    void AsyncWrite_();
 
 private:
     static const int LOG_PATH_LEN = 256;
     static const int LOG_NAME_LEN = 256;
-    static const int MAX_LINES = 50000;
+    static const size_t MAX_FILE_BYTES = 64 * 1024 * 1024; // 单个日志文件上限
+    static const int LINE_MAX_LEN = 2048;     // 单行上限，超出截断
+    static const int LINE_AVG_LEN = 256;      // 估算环形缓冲区大小用
+    static const int FLUSH_BYTES = 64 * 1024; // 文件缓冲攒到这么多就写出
+    static const int FLUSH_INTERVAL_MS = 100; // 缓冲中的日志最多等待这么久
+    static const int BACKEND_IDLE_MS = FLUSH_INTERVAL_MS / 2; // 后台线程的休眠上限
+    static const int WAKE_FRACTION = 4;       // 缓冲区积压超过 1/WAKE_FRACTION 才唤醒后台线程
+    static const int SYNC_LEVEL = 3;          // 达到该级别的行写出后立即落盘
+
+    enum RECORD_TAG // 环形缓冲区中的记录类型，tag 的高位存日志级别
+    {
+        RECORD_TEXT = 0,
+        RECORD_EVENT,
+    };
+    static const int TAG_LEVEL_SHIFT = 8;
+
+    static const char *MODULE_NAME[MODULE_COUNT];
+    static std::atomic<int> moduleLevel_[MODULE_COUNT]; // 未初始化时为 LEVEL_OFF
 
     const char *path_;
     const char *suffix_;
 
-    int MAX_LINES_;
-
-    int lineCount_;
-    int toDay_;
-
     bool isOpen_;
 
-    Buffer buff_;
-    int level_;
     bool isAsync_;
-
-    FILE *fp_;
-    std::unique_ptr<BlockDeque<std::string>> deque_;
-    std::unique_ptr<std::thread> writeThread_;
-    std::mutex mtx_;
+    OVERFLOW_POLICY policy_;
+    LOG_FORMAT format_;
+    size_t ringCapacity_;
+    std::atomic<bool> syncOnError_;
+
+    std::mutex fileMtx_; // 保护以下文件状态
+    RotatingLogFile file_;
+    bool syncPending_;   // 本批有 ERROR 行，写出后需要落盘
+    std::vector<bool> dictWritten_; // 当前二进制文件中已写出字典的格式 id
+    std::atomic<unsigned long long> lines_;
+
+    LogBackend backend_; // 异步模式的后台线程和各线程的环形缓冲区
+    std::atomic<unsigned long long> dropped_;
 };
 
 #define LOG_BASE(level, format, ...) \
     do {\
-        Log* log = Log::Instance();\
-        if (log->isOpen() && log->GetLevel() <= level) {\
-            log->write(level, format, ##__VA_ARGS__); \
+        if (Log::Compiled(level) && Log::Enabled(level, LOG_MODULE)) {\
+            static LogSite logSite_ = {format, level, {0}};\
+            Log* log = Log::Instance();\
+            log->Write(logSite_, ##__VA_ARGS__); \
             log->flush();\
         }\
     } while(0);
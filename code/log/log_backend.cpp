@@ -0,0 +1,164 @@
+#include "log_backend.h"
+#include <chrono>
+#include <cassert>
+
+namespace
+{
+    const int MAX_BACKENDS = 4;
+    std::atomic<int> nextSlot(0);
+
+    // 线程退出时把它的环形缓冲区交给各后台线程回收
+    struct LocalRings
+    {
+        LogRing *rings[MAX_BACKENDS] = {};
+        ~LocalRings()
+        {
+            for (LogRing *ring : rings)
+            {
+                if (ring)
+                {
+                    ring->Retire();
+                }
+            }
+        }
+    };
+    thread_local LocalRings localRings;
+}
+
+LogBackend::LogBackend(int idleMs, int wakeFraction)
+    : slot_(nextSlot++), idleMs_(idleMs), wakeFraction_(wakeFraction), ringCapacity_(0), wakeRequested_(false),
+      backendIdle_(false), blockedCount_(0), isClose_(false)
+{
+    assert(slot_ < MAX_BACKENDS);
+}
+
+LogBackend::~LogBackend()
+{
+    Stop();
+}
+
+void LogBackend::Start(size_t ringCapacity, const Round &round)
+{
+    ringCapacity_ = ringCapacity;
+    if (!thread_)
+    {
+        round_ = round;
+        thread_.reset(new std::thread(&LogBackend::Run_, this));
+    }
+}
+
+void LogBackend::Stop()
+{
+    if (!thread_ || !thread_->joinable())
+    {
+        return;
+    }
+    {
+        std::lock_guard<std::mutex> locker(wakeMtx_);
+        isClose_ = true;
+        wakeRequested_ = true;
+        backendCond_.notify_one();
+    }
+    thread_->join(); //后台线程取空所有缓冲区后退出
+}
+
+LogRing *LogBackend::LocalRing()
+{
+    LogRing *&local = localRings.rings[slot_];
+    if (local == nullptr)
+    {
+        std::unique_ptr<LogRing> ring(new LogRing(ringCapacity_));
+        local = ring.get();
+        std::lock_guard<std::mutex> locker(ringsMtx_);
+        rings_.push_back(std::move(ring));
+    }
+    return local;
+}
+
+LogRing *LogBackend::CurrentRing() const
+{
+    return localRings.rings[slot_];
+}
+
+void LogBackend::Wake()
+{
+    std::lock_guard<std::mutex> locker(wakeMtx_);
+    wakeRequested_ = true;
+    backendCond_.notify_one();
+}
+
+void LogBackend::WakeIfBacklogged(LogRing *ring)
+{
+    //后台线程会定时醒来取走，只有它休眠且缓冲区积压过多时才唤醒
+    if (ring == nullptr || ring->Used() < ring->Capacity() / wakeFraction_)
+    {
+        return;
+    }
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if (backendIdle_.load(std::memory_order_relaxed))
+    {
+        Wake();
+    }
+}
+
+void LogBackend::WaitForSpace(int timeoutMs)
+{
+    blockedCount_++;
+    {
+        std::unique_lock<std::mutex> locker(wakeMtx_);
+        wakeRequested_ = true;
+        backendCond_.notify_one();
+        spaceCond_.wait_for(locker, std::chrono::milliseconds(timeoutMs));
+    }
+    blockedCount_--;
+}
+
+void LogBackend::Run_()
+{
+    std::vector<LogRing *> rings;
+    while (true)
+    {
+        {
+            std::lock_guard<std::mutex> locker(ringsMtx_);
+            for (auto it = rings_.begin(); it != rings_.end();)
+            {
+                //所属线程已退出且已取空，回收
+                if ((*it)->Retired() && (*it)->Empty())
+                {
+                    it = rings_.erase(it);
+                }
+                else
+                {
+                    ++it;
+                }
+            }
+            rings.clear();
+            for (auto &ring : rings_)
+            {
+                rings.push_back(ring.get());
+            }
+        }
+
+        bool closing = isClose_;
+        size_t records = round_(rings, closing);
+        if (records > 0 && blockedCount_ > 0)
+        {
+            std::lock_guard<std::mutex> locker(wakeMtx_);
+            spaceCond_.notify_all();
+        }
+        if (closing)
+        {
+            break; //置 isClose_ 之后又取空了一轮
+        }
+
+        std::unique_lock<std::mutex> locker(wakeMtx_);
+        backendIdle_.store(true);
+        if (!wakeRequested_)
+        {
+            backendCond_.wait_for(locker, std::chrono::milliseconds(idleMs_),
+                                  [this]() { return wakeRequested_; });
+        }
+        wakeRequested_ = false;
+        backendIdle_.store(false);
+    }
+}
@@ -0,0 +1,64 @@
+//
+// 日志后台线程：每个写日志的线程独占一个 LogRing，后台线程定时醒来把所有环交给 Round 回调取空，
+// 线程退出后它的环被取空即回收。Log 与 AccessLog 各持有一个
+//
+#ifndef LOG_BACKEND_H
+#define LOG_BACKEND_H
+
+#include <atomic>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include <memory>
+#include <functional>
+#include <condition_variable>
+#include "log_ring.h"
+
+class LogBackend
+{
+public:
+    // 取空 rings 并写出，返回取出的记录数；closing 为 true 时是退出前的最后一轮，需要写出全部缓冲
+    typedef std::function<size_t(const std::vector<LogRing *> &rings, bool closing)> Round;
+
+    // idleMs 为后台线程的休眠上限，缓冲区积压超过 1/wakeFraction 时由生产者提前唤醒
+    LogBackend(int idleMs, int wakeFraction);
+    ~LogBackend();
+
+    // ringCapacity 用于之后新建的环；后台线程只启动一次
+    void Start(size_t ringCapacity, const Round &round);
+    void Stop(); // 置关闭标志，等后台线程再取空一轮后退出
+    bool IsClosing() const { return isClose_.load(std::memory_order_relaxed); }
+
+    LogRing *LocalRing();         // 当前线程的环，首次调用时注册
+    LogRing *CurrentRing() const; // 当前线程的环，尚未注册返回 nullptr
+
+    void Wake();                      // 立即唤醒后台线程
+    void WakeIfBacklogged(LogRing *ring); // 环积压过多且后台线程在休眠时唤醒，避免每行一次系统调用
+    void WaitForSpace(int timeoutMs); // 环已满的生产者唤醒后台线程并等待其取走一轮
+
+    LogBackend(const LogBackend &) = delete;
+    LogBackend &operator=(const LogBackend &) = delete;
+
+private:
+    void Run_();
+
+    const int slot_; // 实例编号，线程私有的环指针按它存放
+    const int idleMs_;
+    const int wakeFraction_;
+    std::atomic<size_t> ringCapacity_;
+    Round round_;
+    std::unique_ptr<std::thread> thread_;
+
+    std::mutex ringsMtx_; // 保护 rings_，只在线程注册和后台线程取数时使用
+    std::vector<std::unique_ptr<LogRing>> rings_;
+
+    std::mutex wakeMtx_;
+    std::condition_variable backendCond_; // 唤醒后台线程
+    std::condition_variable spaceCond_;   // 通知等待空间的生产者
+    bool wakeRequested_;                  // 有生产者要求后台线程立即处理，受 wakeMtx_ 保护
+    std::atomic<bool> backendIdle_;       // 后台线程正在休眠，生产者需要唤醒它
+    std::atomic<int> blockedCount_;       // 正在等待空间的生产者数
+    std::atomic<bool> isClose_;
+};
+
+#endif
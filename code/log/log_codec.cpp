@@ -0,0 +1,261 @@
+#include "log_codec.h"
+#include <ctime>
+#include <cstdio>
+
+std::mutex LogRegistry::mtx_;
+std::vector<LogRegistry::Entry> LogRegistry::entries_;
+
+const char LogCodec::FILE_MAGIC[FILE_MAGIC_LEN + 1] = "WSLOG1\n";
+
+uint32_t LogRegistry::Register(LogSite &site, const char *types)
+{
+    std::lock_guard<std::mutex> locker(mtx_);
+    uint32_t id = site.id.load(std::memory_order_relaxed);
+    if (id == 0) //其他线程可能已经注册过
+    {
+        entries_.push_back({site.format, types, site.level});
+        id = static_cast<uint32_t>(entries_.size());
+        site.id.store(id, std::memory_order_release);
+    }
+    return id;
+}
+
+bool LogRegistry::Get(uint32_t id, Entry &entry)
+{
+    std::lock_guard<std::mutex> locker(mtx_);
+    if (id == 0 || id > entries_.size())
+    {
+        return false;
+    }
+    entry = entries_[id - 1];
+    return true;
+}
+
+const char *LogCodec::LevelTitle(int level)
+{
+    switch (level)
+    {
+    case 0:
+        return "[debug]: ";
+    case 1:
+        return "[info]: ";
+    case 2:
+        return "[warn]: ";
+    case 3:
+        return "[error]: ";
+    default:
+        return "[info]: ";
+    }
+}
+
+int64_t LogCodec::NowNs()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_REALTIME, &ts);
+    return static_cast<int64_t>(ts.tv_sec) * 1000000000 + ts.tv_nsec;
+}
+
+int LogCodec::FormatPrefix(int64_t ns, int level, char *out)
+{
+    LogTime::Format(ns, out);
+    out[LogTime::LEN] = ' ';
+    const char *title = LevelTitle(level);
+    size_t len = strlen(title);
+    memcpy(out + LogTime::LEN + 1, title, len);
+    return static_cast<int>(LogTime::LEN + 1 + len);
+}
+
+void LogCodec::PutEventHeader(char *p, uint32_t id, uint32_t argLen, int64_t ns)
+{
+    memcpy(p, &id, 4);
+    memcpy(p + 4, &argLen, 4);
+    memcpy(p + 8, &ns, 8);
+}
+
+void LogCodec::GetEventHeader(const char *p, uint32_t &id, uint32_t &argLen, int64_t &ns)
+{
+    memcpy(&id, p, 4);
+    memcpy(&argLen, p + 4, 4);
+    memcpy(&ns, p + 8, 8);
+}
+
+int LogCodec::FormatEvent(const LogRegistry::Entry &entry, int64_t ns, const char *args, size_t argLen,
+                          char *out, size_t size)
+{
+    int n = FormatPrefix(ns, entry.level, out);
+    n += FormatArgs_(entry.format, entry.types, args, argLen, out + n, size - n - 1); //留一个字节给换行
+    out[n] = '\n';
+    return n + 1;
+}
+
+void LogCodec::AppendFormat(Buffer &out, uint32_t id, const LogRegistry::Entry &entry)
+{
+    uint8_t level = static_cast<uint8_t>(entry.level);
+    uint16_t fmtLen = static_cast<uint16_t>(strlen(entry.format));
+    uint16_t typesLen = static_cast<uint16_t>(strlen(entry.types));
+    out.Append("F", 1);
+    out.Append(&id, 4);
+    out.Append(&level, 1);
+    out.Append(&fmtLen, 2);
+    out.Append(&typesLen, 2);
+    out.Append(entry.format, fmtLen);
+    out.Append(entry.types, typesLen);
+}
+
+// 逐个转换说明取出对应参数，按记录下来的类型和宽度截断、扩展后统一以 64 位交给 snprintf
+int LogCodec::FormatArgs_(const char *format, const char *types, const char *args, size_t argLen,
+                          char *out, size_t size)
+{
+    size_t len = 0;
+    size_t pos = 0; //args 中的读取位置
+    auto put = [&](int n) {
+        if (n > 0)
+        {
+            len += static_cast<size_t>(n) < size - len ? n : size - len - 1;
+        }
+    };
+
+    const char *p = format;
+    while (*p && len + 1 < size)
+    {
+        if (*p != '%')
+        {
+            out[len++] = *p++;
+            continue;
+        }
+        if (p[1] == '%')
+        {
+            out[len++] = '%';
+            p += 2;
+            continue;
+        }
+
+        //%[flags][width][.precision][length]conv
+        const char *start = p++;
+        char spec[32];
+        size_t specLen = 0;
+        spec[specLen++] = '%';
+        while (*p && strchr("-+ #0123456789.", *p) && specLen < sizeof(spec) - 4)
+        {
+            spec[specLen++] = *p++;
+        }
+        int narrow = 64; //hh、h 修饰把整数再截到 8、16 位
+        while (*p && strchr("hlLqjzt", *p))
+        {
+            if (*p == 'h')
+            {
+                narrow = narrow == 16 ? 8 : 16;
+            }
+            p++;
+        }
+        char conv = *p;
+        if (conv == '\0')
+        {
+            break;
+        }
+        p++;
+
+        char type = *types;
+        if (type == '\0') //参数不足，原样输出
+        {
+            put(snprintf(out + len, size - len, "%.*s", static_cast<int>(p - start), start));
+            continue;
+        }
+        types++;
+
+        if (type == 's')
+        {
+            uint32_t n;
+            if (pos + 4 > argLen)
+            {
+                break;
+            }
+            memcpy(&n, args + pos, 4);
+            if (n > logarg::STR_MAX || pos + 4 + n > argLen)
+            {
+                break;
+            }
+            char str[logarg::STR_MAX + 1];
+            memcpy(str, args + pos + 4, n);
+            str[n] = '\0';
+            pos += 4 + n;
+            spec[specLen++] = 's';
+            spec[specLen] = '\0';
+            put(snprintf(out + len, size - len, spec, str));
+            continue;
+        }
+
+        if (pos + 8 > argLen)
+        {
+            break;
+        }
+        uint64_t raw;
+        memcpy(&raw, args + pos, 8);
+        pos += 8;
+
+        if (strchr("fFeEgGaA", conv))
+        {
+            double v;
+            if (type == 'd')
+            {
+                memcpy(&v, &raw, 8);
+            }
+            else
+            {
+                v = strchr("iI", type) ? static_cast<double>(static_cast<int64_t>(raw)) : static_cast<double>(raw);
+            }
+            spec[specLen++] = conv;
+            spec[specLen] = '\0';
+            put(snprintf(out + len, size - len, spec, v));
+        }
+        else if (conv == 'c')
+        {
+            spec[specLen++] = 'c';
+            spec[specLen] = '\0';
+            put(snprintf(out + len, size - len, spec, static_cast<int>(raw)));
+        }
+        else if (conv == 'p' || type == 'p')
+        {
+            spec[specLen++] = 'p';
+            spec[specLen] = '\0';
+            put(snprintf(out + len, size - len, spec, reinterpret_cast<void *>(static_cast<uintptr_t>(raw))));
+        }
+        else if (type == 'd')
+        {
+            double v;
+            memcpy(&v, &raw, 8);
+            put(snprintf(out + len, size - len, "%g", v));
+        }
+        else
+        {
+            //%s 误传整数时按 %d 处理
+            if (!strchr("diouxX", conv))
+            {
+                conv = strchr("iI", type) ? 'd' : 'u';
+            }
+            //先截回调用点实参提升后的宽度，再按转换说明的有无符号扩展到 64 位
+            int bits = strchr("IU", type) ? 32 : 64;
+            bits = narrow < bits ? narrow : bits;
+            uint64_t mask = bits == 64 ? ~0ULL : (1ULL << bits) - 1;
+            uint64_t u = raw & mask;
+            int64_t d = static_cast<int64_t>(u);
+            if (bits < 64 && (u >> (bits - 1)))
+            {
+                d = static_cast<int64_t>(u | ~mask); //符号扩展
+            }
+            spec[specLen++] = 'l';
+            spec[specLen++] = 'l';
+            spec[specLen++] = conv;
+            spec[specLen] = '\0';
+            if (conv == 'd' || conv == 'i')
+            {
+                put(snprintf(out + len, size - len, spec, static_cast<long long>(d)));
+            }
+            else
+            {
+                put(snprintf(out + len, size - len, spec, static_cast<unsigned long long>(u)));
+            }
+        }
+    }
+    return static_cast<int>(len);
+}
@@ -0,0 +1,199 @@
+//
+// 二进制日志编码：调用点只记录格式 id、时间戳和原始参数字节，
+// 由后台线程或离线工具 log_decode 再格式化成文本
+//
+// 二进制日志文件由以下记录顺序组成（整数均为本机字节序）：
+//   'H' "WSLOG1\n"                                    文件头，每次打开文件时写入
+//   'F' u32 id, u8 level, u16 fmtLen, u16 typesLen, fmt, types   格式字典，每个文件内首次出现前写入
+//   'E' u32 id, u32 argLen, i64 realtime ns, args              一条日志
+//   'T' u32 len, text                                          已格式化的文本行
+// 参数按类型编码：整数一律存 8 字节，类型码记录提升后的宽度：'I' int，'U' unsigned int，
+// 'i' 64 位有符号，'u' 64 位无符号；'d' double，'p' u64，'s' u32 len + 字节
+//
+#ifndef LOG_CODEC_H
+#define LOG_CODEC_H
+
+#include <atomic>
+#include <mutex>
+#include <vector>
+#include <string>
+#include <cstdint>
+#include <cstring>
+#include <type_traits>
+#include "../buffer/buffer.h"
+#include "log_time.h"
+
+// 每个日志调用点一个，静态存储，首次以二进制模式写入时注册得到 id
+struct LogSite
+{
+    const char *format;
+    int level;
+    std::atomic<uint32_t> id; // 0 表示尚未注册
+};
+
+class LogRegistry
+{
+public:
+    struct Entry
+    {
+        const char *format;
+        const char *types;
+        int level;
+    };
+
+    static uint32_t Register(LogSite &site, const char *types);
+    static bool Get(uint32_t id, Entry &entry);
+
+private:
+    static std::mutex mtx_;
+    static std::vector<Entry> entries_; // 下标为 id - 1
+};
+
+namespace logarg
+{
+    static const size_t STR_MAX = 512; // 单个字符串参数的记录上限，超出截断
+
+    template <class T, class Enable = void>
+    struct Codec;
+
+    // 不宽于 int 的整数按默认实参提升记为 int/unsigned int，解码时先截回该宽度，%u、%x 输出与文本模式一致
+    template <class T>
+    struct Codec<T, typename std::enable_if<(std::is_integral<T>::value && std::is_signed<T>::value) ||
+                                            std::is_enum<T>::value>::type>
+    {
+        static const char CODE = sizeof(T) <= sizeof(int) ? 'I' : 'i';
+        static size_t Size(T) { return 8; }
+        static char *Encode(char *p, T v)
+        {
+            int64_t x = static_cast<int64_t>(v);
+            memcpy(p, &x, 8);
+            return p + 8;
+        }
+    };
+
+    template <class T>
+    struct Codec<T, typename std::enable_if<std::is_integral<T>::value && std::is_unsigned<T>::value>::type>
+    {
+        static const char CODE = sizeof(T) < sizeof(int) ? 'I' : sizeof(T) == sizeof(int) ? 'U' : 'u';
+        static size_t Size(T) { return 8; }
+        static char *Encode(char *p, T v)
+        {
+            uint64_t x = static_cast<uint64_t>(v);
+            memcpy(p, &x, 8);
+            return p + 8;
+        }
+    };
+
+    template <class T>
+    struct Codec<T, typename std::enable_if<std::is_floating_point<T>::value>::type>
+    {
+        static const char CODE = 'd';
+        static size_t Size(T) { return 8; }
+        static char *Encode(char *p, T v)
+        {
+            double x = static_cast<double>(v);
+            memcpy(p, &x, 8);
+            return p + 8;
+        }
+    };
+
+    struct StrCodec
+    {
+        static const char CODE = 's';
+        static size_t Len(const char *s, size_t len) { return s ? (len < STR_MAX ? len : STR_MAX) : 6; }
+        static char *Put(char *p, const char *s, size_t len)
+        {
+            if (s == nullptr)
+            {
+                s = "(null)";
+            }
+            uint32_t n = static_cast<uint32_t>(len);
+            memcpy(p, &n, 4);
+            memcpy(p + 4, s, n);
+            return p + 4 + n;
+        }
+    };
+
+    template <>
+    struct Codec<const char *> : StrCodec
+    {
+        static size_t Size(const char *s) { return 4 + Len(s, s ? strlen(s) : 0); }
+        static char *Encode(char *p, const char *s) { return Put(p, s, Len(s, s ? strlen(s) : 0)); }
+    };
+
+    template <>
+    struct Codec<char *> : Codec<const char *>
+    {
+    };
+
+    template <>
+    struct Codec<std::string> : StrCodec
+    {
+        static size_t Size(const std::string &s) { return 4 + Len(s.data(), s.size()); }
+        static char *Encode(char *p, const std::string &s) { return Put(p, s.data(), Len(s.data(), s.size())); }
+    };
+
+    template <class T>
+    struct Codec<T *, typename std::enable_if<!std::is_same<typename std::remove_cv<T>::type, char>::value>::type>
+    {
+        static const char CODE = 'p';
+        static size_t Size(const T *) { return 8; }
+        static char *Encode(char *p, const T *v)
+        {
+            uint64_t x = reinterpret_cast<uintptr_t>(v);
+            memcpy(p, &x, 8);
+            return p + 8;
+        }
+    };
+
+    // 编译期生成参数类型串，如 LOG_INFO("%s:%d", ip, port) 为 "si"
+    template <class... Args>
+    struct Types
+    {
+        static const char value[sizeof...(Args) + 1];
+    };
+    template <class... Args>
+    const char Types<Args...>::value[sizeof...(Args) + 1] = {Codec<Args>::CODE..., '\0'};
+
+    inline size_t Size() { return 0; }
+    template <class T, class... Rest>
+    size_t Size(const T &v, const Rest &...rest)
+    {
+        return Codec<typename std::decay<T>::type>::Size(v) + Size(rest...);
+    }
+
+    inline char *Encode(char *p) { return p; }
+    template <class T, class... Rest>
+    char *Encode(char *p, const T &v, const Rest &...rest)
+    {
+        return Encode(Codec<typename std::decay<T>::type>::Encode(p, v), rest...);
+    }
+}
+
+class LogCodec
+{
+public:
+    static const size_t EVENT_HEADER = 16; // u32 id + u32 argLen + i64 ns
+    static const size_t FILE_MAGIC_LEN = 7;
+    static const char FILE_MAGIC[FILE_MAGIC_LEN + 1]; // 'H' 记录的内容
+
+    static const char *LevelTitle(int level);
+    static int64_t NowNs(); // CLOCK_REALTIME，经 vDSO 读取，不进内核
+    // 写出 "时间戳 [level]: " 前缀，返回长度
+    static int FormatPrefix(int64_t ns, int level, char *out);
+
+    static void PutEventHeader(char *p, uint32_t id, uint32_t argLen, int64_t ns);
+    static void GetEventHeader(const char *p, uint32_t &id, uint32_t &argLen, int64_t &ns);
+
+    // 格式化成与文本模式一致的一行（含换行），返回长度
+    static int FormatEvent(const LogRegistry::Entry &entry, int64_t ns, const char *args, size_t argLen,
+                           char *out, size_t size);
+    // 写出 'F' 字典记录
+    static void AppendFormat(Buffer &out, uint32_t id, const LogRegistry::Entry &entry);
+
+private:
+    static int FormatArgs_(const char *format, const char *types, const char *args, size_t argLen,
+                           char *out, size_t size);
+};
+
+#endif
@@ -0,0 +1,218 @@
+#include "log_file.h"
+#include "log_time.h"
+#include <cassert>
+#include <cerrno>
+#include <cstdlib>
+#include <cstring>
+#include <cstdio>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
+
+LogFile::LogFile(size_t bufSize, int flushIntervalMs)
+    : fd_(-1), buf_(nullptr), cap_((bufSize + ALIGN - 1) / ALIGN * ALIGN), len_(0), written_(0), allocated_(0),
+      preallocOk_(true), flushInterval_(flushIntervalMs), writes_(0), syncs_(0)
+{
+    void *p = nullptr;
+    int ret = posix_memalign(&p, ALIGN, cap_);
+    assert(ret == 0);
+    (void)ret;
+    buf_ = static_cast<char *>(p);
+}
+
+LogFile::~LogFile()
+{
+    Close();
+    free(buf_);
+}
+
+bool LogFile::Open(const char *fileName)
+{
+    Close();
+    fd_ = open(fileName, O_WRONLY | O_CREAT | O_APPEND | O_CLOEXEC, 0644);
+    if (fd_ < 0)
+    {
+        return false;
+    }
+    struct stat st;
+    written_ = fstat(fd_, &st) == 0 ? static_cast<size_t>(st.st_size) : 0;
+    allocated_ = written_;
+    preallocOk_ = true;
+    return true;
+}
+
+void LogFile::Close()
+{
+    if (fd_ < 0)
+    {
+        return;
+    }
+    Flush();
+    if (allocated_ > written_)
+    {
+        // FALLOC_FL_KEEP_SIZE 预分配的块在文件尾之后，截断到实际大小释放掉
+        int ret = ftruncate(fd_, static_cast<off_t>(written_));
+        (void)ret;
+    }
+    close(fd_);
+    fd_ = -1;
+    len_ = 0;
+}
+
+void LogFile::Append(const char *data, size_t len)
+{
+    if (len_ + len > cap_)
+    {
+        Flush();
+    }
+    if (len > cap_) //超大记录直接写
+    {
+        memcpy(buf_, data, cap_);
+        len_ = cap_;
+        Flush();
+        Append(data + cap_, len - cap_);
+        return;
+    }
+    memcpy(BeginWrite(len), data, len);
+    HasWritten(len);
+}
+
+char *LogFile::BeginWrite(size_t len)
+{
+    assert(len <= cap_);
+    if (len_ + len > cap_)
+    {
+        Flush();
+    }
+    return buf_ + len_;
+}
+
+void LogFile::HasWritten(size_t len)
+{
+    if (len_ == 0)
+    {
+        firstPending_ = LogTime::CoarseSteady();
+    }
+    len_ += len;
+}
+
+bool LogFile::FlushDue(std::chrono::steady_clock::time_point now) const
+{
+    return len_ > 0 && (len_ * 2 >= cap_ || now - firstPending_ >= flushInterval_);
+}
+
+void LogFile::Flush()
+{
+    if (len_ == 0 || fd_ < 0)
+    {
+        len_ = 0;
+        return;
+    }
+    Preallocate_(written_ + len_);
+    size_t off = 0;
+    while (off < len_)
+    {
+        ssize_t n = write(fd_, buf_ + off, len_ - off);
+        writes_.fetch_add(1, std::memory_order_relaxed);
+        if (n < 0)
+        {
+            if (errno == EINTR)
+            {
+                continue;
+            }
+            break; //磁盘满等错误：丢弃本批，日志不能阻塞服务
+        }
+        off += static_cast<size_t>(n);
+    }
+    written_ += off;
+    len_ = 0;
+}
+
+void LogFile::Sync()
+{
+    Flush();
+    if (fd_ >= 0)
+    {
+        fdatasync(fd_);
+        syncs_.fetch_add(1, std::memory_order_relaxed);
+    }
+}
+
+void LogFile::Preallocate_(size_t end)
+{
+    if (!preallocOk_ || end <= allocated_)
+    {
+        return;
+    }
+    size_t target = (end + PREALLOC_CHUNK - 1) / PREALLOC_CHUNK * PREALLOC_CHUNK;
+    if (fallocate(fd_, FALLOC_FL_KEEP_SIZE, static_cast<off_t>(allocated_),
+                  static_cast<off_t>(target - allocated_)) == 0)
+    {
+        allocated_ = target;
+    }
+    else
+    {
+        preallocOk_ = false;
+    }
+}
+
+RotatingLogFile::RotatingLogFile(size_t bufSize, int flushIntervalMs, size_t maxBytes)
+    : LogFile(bufSize, flushIntervalMs), maxBytes_(maxBytes), nextDay_(0), fileIndex_(0)
+{
+    today_[0] = '\0';
+}
+
+bool RotatingLogFile::Open(const char *dir, const char *prefix, const char *suffix, time_t now)
+{
+    dir_ = dir;
+    prefix_ = prefix;
+    suffix_ = suffix;
+    nextDay_ = 0;
+    return OpenNext_(now);
+}
+
+bool RotatingLogFile::RotateIfNeeded(time_t now)
+{
+    if (now < nextDay_ && Size() < maxBytes_)
+    {
+        return false;
+    }
+    OpenNext_(now);
+    return true;
+}
+
+bool RotatingLogFile::OpenNext_(time_t now)
+{
+    if (now >= nextDay_)
+    {
+        struct tm t;
+        localtime_r(&now, &t);
+        snprintf(today_, sizeof(today_), "%04d_%02d_%02d", t.tm_year + 1900, t.tm_mon + 1, t.tm_mday);
+        t.tm_mday += 1; //下一天零点，mktime 会处理月末进位
+        t.tm_hour = t.tm_min = t.tm_sec = 0;
+        t.tm_isdst = -1;
+        nextDay_ = mktime(&t);
+        fileIndex_ = 0;
+    }
+    else
+    {
+        fileIndex_++;
+    }
+
+    char fileName[512];
+    if (fileIndex_ == 0)
+    {
+        snprintf(fileName, sizeof(fileName), "%s/%s%s%s", dir_.c_str(), prefix_.c_str(), today_, suffix_.c_str());
+    }
+    else
+    {
+        snprintf(fileName, sizeof(fileName), "%s/%s%s-%d%s", dir_.c_str(), prefix_.c_str(), today_, fileIndex_,
+                 suffix_.c_str());
+    }
+    if (!LogFile::Open(fileName)) //Open 会先写出并关闭旧文件
+    {
+        mkdir(dir_.c_str(), 0777); //所有用户都可读/写/执行
+        return LogFile::Open(fileName);
+    }
+    return true;
+}
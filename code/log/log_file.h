@@ -0,0 +1,76 @@
+//
+// 日志文件写入：日志先攒进页对齐的大缓冲区，按大小或时间阈值一次 write 出去，
+// 文件按块 fallocate 预分配，减少写入时的块分配和碎片；RotatingLogFile 再按日期和大小切换文件
+//
+#ifndef LOG_FILE_H
+#define LOG_FILE_H
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <ctime>
+#include <string>
+
+class LogFile
+{
+public:
+    explicit LogFile(size_t bufSize = 64 * 1024, int flushIntervalMs = 100);
+    ~LogFile();
+
+    bool Open(const char *fileName); // 追加打开，失败返回 false
+    void Close();                    // 写出缓冲并释放预分配但未使用的空间
+    bool IsOpen() const { return fd_ >= 0; }
+
+    void Append(const char *data, size_t len);
+    char *BeginWrite(size_t len); // 原地格式化：保证至少 len 字节连续可写
+    void HasWritten(size_t len);
+
+    bool FlushDue(std::chrono::steady_clock::time_point now) const; // 缓冲过半或最早一行已等待超过阈值
+    void Flush();                                                   // 一次 write 写出缓冲
+    void Sync();                                                    // Flush 后 fdatasync，保证落盘
+
+    size_t Size() const { return written_ + len_; } // 文件大小，包含尚在缓冲中的部分
+    unsigned long long Writes() const { return writes_.load(std::memory_order_relaxed); }
+    unsigned long long Syncs() const { return syncs_.load(std::memory_order_relaxed); }
+
+private:
+    void Preallocate_(size_t end); // 保证 end 之前的空间已分配
+
+    static const size_t ALIGN = 4096;
+    static const size_t PREALLOC_CHUNK = 4 * 1024 * 1024;
+
+    int fd_;
+    char *buf_;
+    size_t cap_;
+    size_t len_;
+    size_t written_;   // 已写入文件的字节数
+    size_t allocated_; // 已预分配到的文件偏移
+    bool preallocOk_;  // 文件系统不支持 fallocate 时不再尝试
+    std::chrono::milliseconds flushInterval_;
+    std::chrono::steady_clock::time_point firstPending_; // 缓冲中最早一行的写入时间
+
+    std::atomic<unsigned long long> writes_; // write 系统调用次数
+    std::atomic<unsigned long long> syncs_;  // fdatasync 次数
+};
+
+// 按日期和大小切换的日志文件：dir/prefix + YYYY_MM_DD[-序号] + suffix
+class RotatingLogFile : public LogFile
+{
+public:
+    RotatingLogFile(size_t bufSize, int flushIntervalMs, size_t maxBytes);
+
+    bool Open(const char *dir, const char *prefix, const char *suffix, time_t now); // 从当天第一个文件开始
+    bool RotateIfNeeded(time_t now); // 跨天或超过大小上限时切换到下一个文件，切换了返回 true
+    bool Full() const { return Size() >= maxBytes_; }
+
+private:
+    bool OpenNext_(time_t now);
+
+    size_t maxBytes_;
+    std::string dir_, prefix_, suffix_;
+    time_t nextDay_;  // 到这个时刻切换到下一天的文件
+    char today_[32];  // 当前文件的日期部分
+    int fileIndex_;   // 当天第几个文件，超过大小上限时递增
+};
+
+#endif
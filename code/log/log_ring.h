@@ -0,0 +1,133 @@
+//
+// 单生产者单消费者的日志环形缓冲区：每个写日志的线程独占一个，
+// 生产者直接把日志行格式化进环里，后台线程批量取走，全程无锁
+//
+#ifndef LOG_RING_H
+#define LOG_RING_H
+
+#include <atomic>
+#include <memory>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <cassert>
+
+class LogRing
+{
+public:
+    explicit LogRing(size_t capacity) // capacity 向上取整为 2 的幂
+        : head_(0), tail_(0), cachedTail_(0), reserved_(0), retired_(false)
+    {
+        size_t cap = MIN_CAPACITY;
+        while (cap < capacity)
+        {
+            cap <<= 1;
+        }
+        capacity_ = cap;
+        mask_ = cap - 1;
+        buf_.reset(new char[cap]);
+    }
+
+    // 生产者：预留最多 maxLen 字节的连续空间，空间不足返回 nullptr
+    char *Reserve(size_t maxLen)
+    {
+        size_t need = HEADER + Align_(maxLen);
+        assert(need <= capacity_ / 2);
+        size_t head = head_.load(std::memory_order_relaxed);
+        size_t pos = head & mask_;
+        size_t pad = capacity_ - pos < need ? capacity_ - pos : 0; // 尾部放不下，跳到开头
+        if (head + pad + need - cachedTail_ > capacity_)
+        {
+            cachedTail_ = tail_.load(std::memory_order_acquire);
+            if (head + pad + need - cachedTail_ > capacity_)
+            {
+                return nullptr;
+            }
+        }
+        if (pad)
+        {
+            SetLen_(pos, PAD);
+            head += pad;
+            head_.store(head, std::memory_order_release);
+            pos = 0;
+        }
+        reserved_ = head;
+        return buf_.get() + pos + HEADER;
+    }
+
+    // 生产者：提交 Reserve 之后实际写入的 len 字节，tag 由消费者解释记录类型
+    void Commit(size_t len, uint32_t tag = 0)
+    {
+        memcpy(buf_.get() + (reserved_ & mask_) + sizeof(uint32_t), &tag, sizeof(tag));
+        SetLen_(reserved_ & mask_, static_cast<uint32_t>(len));
+        head_.store(reserved_ + HEADER + Align_(len), std::memory_order_release);
+    }
+
+    // 消费者：依次把每条记录交给 sink(const char*, size_t, uint32_t tag)，返回取走的记录数
+    template <class Sink>
+    size_t Drain(Sink &&sink)
+    {
+        size_t head = head_.load(std::memory_order_acquire);
+        size_t tail = tail_.load(std::memory_order_relaxed);
+        size_t count = 0;
+        while (tail != head)
+        {
+            size_t pos = tail & mask_;
+            uint32_t len;
+            memcpy(&len, buf_.get() + pos, sizeof(len));
+            if (len == PAD)
+            {
+                tail += capacity_ - pos;
+                continue;
+            }
+            uint32_t tag;
+            memcpy(&tag, buf_.get() + pos + sizeof(uint32_t), sizeof(tag));
+            sink(buf_.get() + pos + HEADER, static_cast<size_t>(len), tag);
+            tail += HEADER + Align_(len);
+            ++count;
+        }
+        tail_.store(tail, std::memory_order_release);
+        return count;
+    }
+
+    bool Empty() const
+    {
+        return head_.load(std::memory_order_acquire) == tail_.load(std::memory_order_acquire);
+    }
+
+    size_t Capacity() const { return capacity_; }
+
+    // 生产者：已写入未被取走的字节数
+    size_t Used() const
+    {
+        return head_.load(std::memory_order_relaxed) - tail_.load(std::memory_order_acquire);
+    }
+
+    // 所属线程退出后标记，后台线程取空后回收
+    void Retire() { retired_.store(true, std::memory_order_release); }
+    bool Retired() const { return retired_.load(std::memory_order_acquire); }
+
+private:
+    static const size_t HEADER = 8;         // 记录头：长度 + 类型，按 8 字节对齐
+    static const uint32_t PAD = 0xFFFFFFFFu; // 填充标记：本圈剩余部分跳过
+    static const size_t MIN_CAPACITY = 4096;
+    static const size_t CACHE_LINE = 64;
+
+    static size_t Align_(size_t n) { return (n + HEADER - 1) & ~(HEADER - 1); }
+    void SetLen_(size_t pos, uint32_t len) { memcpy(buf_.get() + pos, &len, sizeof(len)); }
+
+    // head_、tail_ 分处不同缓存行，避免生产者与消费者伪共享
+    std::atomic<size_t> head_; // 生产者写到的位置（单调递增）
+    char headPad_[CACHE_LINE - sizeof(std::atomic<size_t>)];
+    std::atomic<size_t> tail_; // 消费者读到的位置（单调递增）
+    char tailPad_[CACHE_LINE - sizeof(std::atomic<size_t>)];
+    size_t cachedTail_; // 生产者缓存的 tail_，减少跨核读取
+    size_t reserved_;   // 已预留未提交的记录起点
+
+    size_t capacity_;
+    size_t mask_;
+    std::unique_ptr<char[]> buf_;
+    std::atomic<bool> retired_;
+};
+
+#endif
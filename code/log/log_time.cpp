@@ -0,0 +1,62 @@
+#include "log_time.h"
+#include <cstdio>
+#include <cstring>
+
+namespace
+{
+    struct PrefixCache
+    {
+        int64_t sec = -1;
+        char prefix[64]; // "YYYY-MM-DD HH:MM:SS."，留足 snprintf 的余量
+    };
+    thread_local PrefixCache prefixCache;
+
+    inline void PutDigits(char *p, long v, int n)
+    {
+        for (int i = n - 1; i >= 0; i--)
+        {
+            p[i] = static_cast<char>('0' + v % 10);
+            v /= 10;
+        }
+    }
+}
+
+void LogTime::Format(int64_t ns, char *out)
+{
+    int64_t sec = ns / 1000000000;
+    PrefixCache &cache = prefixCache;
+    if (sec != cache.sec)
+    {
+        // 时区偏移和夏令时切换都是整分钟，同一分钟内本地时间的秒数与 UTC 相同
+        if (cache.sec >= 0 && sec / 60 == cache.sec / 60)
+        {
+            PutDigits(cache.prefix + 17, static_cast<long>(sec % 60), 2);
+        }
+        else
+        {
+            time_t tSec = static_cast<time_t>(sec);
+            struct tm t;
+            localtime_r(&tSec, &t);
+            snprintf(cache.prefix, sizeof(cache.prefix), "%04d-%02d-%02d %02d:%02d:%02d.",
+                     t.tm_year + 1900, t.tm_mon + 1, t.tm_mday, t.tm_hour, t.tm_min, t.tm_sec);
+        }
+        cache.sec = sec;
+    }
+    memcpy(out, cache.prefix, 20);
+    PutDigits(out + 20, static_cast<long>(ns % 1000000000 / 1000), 6);
+}
+
+time_t LogTime::CoarseSeconds()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_REALTIME_COARSE, &ts);
+    return ts.tv_sec;
+}
+
+std::chrono::steady_clock::time_point LogTime::CoarseSteady()
+{
+    // steady_clock 即 CLOCK_MONOTONIC，它的粗粒度版本可以直接比较
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC_COARSE, &ts);
+    return std::chrono::steady_clock::time_point(std::chrono::seconds(ts.tv_sec) + std::chrono::nanoseconds(ts.tv_nsec));
+}
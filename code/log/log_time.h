@@ -0,0 +1,25 @@
+//
+// 日志时间戳：每个线程缓存已格式化的 "YYYY-MM-DD HH:MM:SS." 前缀，
+// 同一秒内只改写微秒，同一分钟内只改写秒，跨分钟才调用一次 localtime_r
+//
+#ifndef LOG_TIME_H
+#define LOG_TIME_H
+
+#include <chrono>
+#include <cstdint>
+#include <ctime>
+
+class LogTime
+{
+public:
+    static const int LEN = 26; // "YYYY-MM-DD HH:MM:SS.uuuuuu"
+
+    // 写出 LEN 字节，不带结尾 '\0'；ns 为 CLOCK_REALTIME 纳秒
+    static void Format(int64_t ns, char *out);
+
+    // 粗粒度时钟（毫秒级精度），只用于跨天、刷盘间隔这类不需要精确时间的判断
+    static time_t CoarseSeconds();
+    static std::chrono::steady_clock::time_point CoarseSteady();
+};
+
+#endif
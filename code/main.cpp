@@ -2,6 +2,9 @@
 
 int main()
 {
-    WebServer server(8080, 3, 60000, true, 16, 3306, "root", "root", "mydb", 10, true, 1, 1024);
+    WebServerOptions options;
+    options.maxThreadNum = 32;
+    options.maxConnPoolNum = 20;
+    WebServer server(8080, 3, 60000, true, 8, 3306, "root", "root", "mydb", 10, true, 1, 1024, options);
     server.Start();
-}
\ No newline at end of file
+}
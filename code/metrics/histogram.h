@@ -0,0 +1,100 @@
+//
+// 无锁延迟直方图：对数-线性分桶（HDR 风格），每个 2 的幂区间再等分为 SUB_BUCKETS 个线性子桶，
+// 相对误差不超过 1/SUB_BUCKETS；记录只需一次原子加
+//
+#ifndef HISTOGRAM_H
+#define HISTOGRAM_H
+
+#include <atomic>
+#include <cstdint>
+
+class LatencyHistogram
+{
+public:
+    static const int SUB_BITS = 3;
+    static const int SUB_BUCKETS = 1 << SUB_BITS; // 每个 2 的幂区间的子桶数
+    static const int MAX_EXP = 39;                // 覆盖到 2^40 微秒，更大的值计入最后一个桶
+    // [0, SUB_BUCKETS) 每微秒一个桶；之后 [2^e, 2^(e+1)) 分为 SUB_BUCKETS 个等宽子桶
+    static const int BUCKETS = SUB_BUCKETS + (MAX_EXP - SUB_BITS + 1) * SUB_BUCKETS;
+
+    LatencyHistogram()
+    {
+        for (int i = 0; i < BUCKETS; i++)
+        {
+            buckets_[i] = 0;
+        }
+        count_ = 0;
+        sumUs_ = 0;
+    }
+
+    void Record(int64_t us)
+    {
+        if (us < 0)
+        {
+            us = 0;
+        }
+        buckets_[BucketIndex(us)].fetch_add(1, std::memory_order_relaxed);
+        count_.fetch_add(1, std::memory_order_relaxed);
+        sumUs_.fetch_add(static_cast<uint64_t>(us), std::memory_order_relaxed);
+    }
+
+    uint64_t Count() const { return count_.load(std::memory_order_relaxed); }
+    uint64_t SumUs() const { return sumUs_.load(std::memory_order_relaxed); }
+    uint64_t BucketCount(int i) const { return buckets_[i].load(std::memory_order_relaxed); }
+
+    static int BucketIndex(int64_t us)
+    {
+        uint64_t v = static_cast<uint64_t>(us);
+        if (v < SUB_BUCKETS)
+        {
+            return static_cast<int>(v);
+        }
+        int exp = 63 - __builtin_clzll(v);
+        if (exp > MAX_EXP)
+        {
+            return BUCKETS - 1;
+        }
+        int sub = static_cast<int>((v >> (exp - SUB_BITS)) & (SUB_BUCKETS - 1));
+        return SUB_BUCKETS + (exp - SUB_BITS) * SUB_BUCKETS + sub;
+    }
+
+    // 桶内最大值（微秒，含）
+    static int64_t BucketUpperUs(int i)
+    {
+        if (i < SUB_BUCKETS)
+        {
+            return i;
+        }
+        int shift = (i - SUB_BUCKETS) / SUB_BUCKETS; // 子桶宽度为 2^shift
+        int64_t sub = SUB_BUCKETS + (i - SUB_BUCKETS) % SUB_BUCKETS;
+        return ((sub + 1) << shift) - 1;
+    }
+
+    // 返回 p 分位（0~1）所在桶的上界（微秒）
+    int64_t Percentile(double p) const
+    {
+        uint64_t total = Count();
+        if (total == 0)
+        {
+            return 0;
+        }
+        uint64_t rank = static_cast<uint64_t>(p * total);
+        uint64_t seen = 0;
+        for (int i = 0; i < BUCKETS; i++)
+        {
+            seen += BucketCount(i);
+            if (seen > rank)
+            {
+                return BucketUpperUs(i);
+            }
+        }
+        return BucketUpperUs(BUCKETS - 1);
+    }
+
+private:
+    std::atomic<uint64_t> buckets_[BUCKETS];
+    std::atomic<uint64_t> count_;
+    std::atomic<uint64_t> sumUs_;
+};
+
+#endif
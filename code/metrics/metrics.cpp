@@ -0,0 +1,256 @@
+#include "metrics.h"
+#include <cstdio>
+#include <algorithm>
+
+std::atomic<int> MetricShard::next_(0);
+
+uint64_t MetricHistogram::Count() const
+{
+    uint64_t sum = 0;
+    for (auto &shard : shards_)
+    {
+        sum += shard.hist.Count();
+    }
+    return sum;
+}
+
+uint64_t MetricHistogram::SumUs() const
+{
+    uint64_t sum = 0;
+    for (auto &shard : shards_)
+    {
+        sum += shard.hist.SumUs();
+    }
+    return sum;
+}
+
+uint64_t MetricHistogram::BucketCount(int i) const
+{
+    uint64_t sum = 0;
+    for (auto &shard : shards_)
+    {
+        sum += shard.hist.BucketCount(i);
+    }
+    return sum;
+}
+
+int64_t MetricHistogram::Percentile(double p) const
+{
+    uint64_t buckets[BUCKETS];
+    uint64_t total = 0;
+    for (int i = 0; i < BUCKETS; i++)
+    {
+        buckets[i] = BucketCount(i);
+        total += buckets[i];
+    }
+    if (total == 0)
+    {
+        return 0;
+    }
+    uint64_t rank = static_cast<uint64_t>(p * total);
+    uint64_t seen = 0;
+    for (int i = 0; i < BUCKETS; i++)
+    {
+        seen += buckets[i];
+        if (seen > rank)
+        {
+            return BucketUpperUs(i);
+        }
+    }
+    return BucketUpperUs(BUCKETS - 1);
+}
+
+MetricsRegistry *MetricsRegistry::Instance()
+{
+    static MetricsRegistry registry;
+    return &registry;
+}
+
+MetricsRegistry::Metric *MetricsRegistry::Find_(const std::string &name, const std::string &labels, TYPE type)
+{
+    for (auto &metric : metrics_)
+    {
+        if (metric->name == name && metric->labels == labels && metric->type == type && !metric->fn)
+        {
+            return metric.get();
+        }
+    }
+    return nullptr;
+}
+
+MetricsRegistry::Metric *MetricsRegistry::Add_(const std::string &name, const std::string &help,
+                                               const std::string &labels, TYPE type)
+{
+    std::unique_ptr<Metric> metric(new Metric());
+    metric->name = name;
+    metric->help = help;
+    metric->labels = labels;
+    metric->type = type;
+    metric->owner = nullptr;
+    metrics_.push_back(std::move(metric));
+    return metrics_.back().get();
+}
+
+MetricCounter *MetricsRegistry::Counter(const std::string &name, const std::string &help, const std::string &labels)
+{
+    std::lock_guard<std::mutex> locker(mtx_);
+    Metric *metric = Find_(name, labels, TYPE_COUNTER);
+    if (metric == nullptr)
+    {
+        metric = Add_(name, help, labels, TYPE_COUNTER);
+        metric->counter.reset(new MetricCounter());
+    }
+    return metric->counter.get();
+}
+
+MetricGauge *MetricsRegistry::Gauge(const std::string &name, const std::string &help, const std::string &labels)
+{
+    std::lock_guard<std::mutex> locker(mtx_);
+    Metric *metric = Find_(name, labels, TYPE_GAUGE);
+    if (metric == nullptr)
+    {
+        metric = Add_(name, help, labels, TYPE_GAUGE);
+        metric->gauge.reset(new MetricGauge());
+    }
+    return metric->gauge.get();
+}
+
+MetricHistogram *MetricsRegistry::Histogram(const std::string &name, const std::string &help, const std::string &labels)
+{
+    std::lock_guard<std::mutex> locker(mtx_);
+    Metric *metric = Find_(name, labels, TYPE_HISTOGRAM);
+    if (metric == nullptr)
+    {
+        metric = Add_(name, help, labels, TYPE_HISTOGRAM);
+        metric->histogram.reset(new MetricHistogram());
+    }
+    return metric->histogram.get();
+}
+
+void MetricsRegistry::CounterFunc(const std::string &name, const std::string &help, const std::string &labels,
+                                  std::function<double()> fn, const void *owner)
+{
+    std::lock_guard<std::mutex> locker(mtx_);
+    Metric *metric = Add_(name, help, labels, TYPE_COUNTER);
+    metric->fn = std::move(fn);
+    metric->owner = owner;
+}
+
+void MetricsRegistry::GaugeFunc(const std::string &name, const std::string &help, const std::string &labels,
+                                std::function<double()> fn, const void *owner)
+{
+    std::lock_guard<std::mutex> locker(mtx_);
+    Metric *metric = Add_(name, help, labels, TYPE_GAUGE);
+    metric->fn = std::move(fn);
+    metric->owner = owner;
+}
+
+void MetricsRegistry::RemoveCallbacks(const void *owner)
+{
+    std::lock_guard<std::mutex> locker(mtx_);
+    metrics_.erase(std::remove_if(metrics_.begin(), metrics_.end(),
+                                  [owner](const std::unique_ptr<Metric> &metric)
+                                  { return metric->fn && metric->owner == owner; }),
+                   metrics_.end());
+}
+
+namespace
+{
+    void AppendSample(std::string &out, const std::string &name, const std::string &labels, const char *value)
+    {
+        out += name;
+        if (!labels.empty())
+        {
+            out += '{';
+            out += labels;
+            out += '}';
+        }
+        out += ' ';
+        out += value;
+        out += '\n';
+    }
+}
+
+void MetricsRegistry::RenderHistogram_(std::string &out, const Metric &metric)
+{
+    const MetricHistogram &hist = *metric.histogram;
+    std::string prefix = metric.labels.empty() ? "" : metric.labels + ",";
+    char value[64];
+    uint64_t cumulative = 0;
+    for (int i = 0; i < EXPORT_BUCKETS; i++)
+    {
+        cumulative += hist.BucketCount(i);
+        // 上界是整数微秒，按秒输出精确的十进制并去掉末尾的 0（%g 只有 6 位有效数字）
+        long long us = MetricHistogram::BucketUpperUs(i);
+        char le[48];
+        int n = snprintf(le, sizeof(le), "le=\"%lld.%06lld", us / 1000000, us % 1000000);
+        while (le[n - 1] == '0')
+        {
+            n--;
+        }
+        if (le[n - 1] == '.')
+        {
+            n--;
+        }
+        le[n++] = '"';
+        le[n] = '\0';
+        snprintf(value, sizeof(value), "%llu", static_cast<unsigned long long>(cumulative));
+        AppendSample(out, metric.name + "_bucket", prefix + le, value);
+    }
+    uint64_t count = hist.Count();
+    snprintf(value, sizeof(value), "%llu", static_cast<unsigned long long>(count));
+    AppendSample(out, metric.name + "_bucket", prefix + "le=\"+Inf\"", value);
+    snprintf(value, sizeof(value), "%.10g", static_cast<double>(hist.SumUs()) / 1e6);
+    AppendSample(out, metric.name + "_sum", metric.labels, value);
+    snprintf(value, sizeof(value), "%llu", static_cast<unsigned long long>(count));
+    AppendSample(out, metric.name + "_count", metric.labels, value);
+}
+
+std::string MetricsRegistry::Render() const
+{
+    static const char *TYPE_NAME[] = {"counter", "gauge", "histogram"};
+    std::lock_guard<std::mutex> locker(mtx_);
+    std::string out;
+    out.reserve(16 * 1024);
+    std::vector<bool> done(metrics_.size(), false);
+    for (size_t i = 0; i < metrics_.size(); i++)
+    {
+        if (done[i])
+        {
+            continue;
+        }
+        const Metric &head = *metrics_[i];
+        out += "# HELP " + head.name + " " + head.help + "\n";
+        out += "# TYPE " + head.name + " " + TYPE_NAME[head.type] + "\n";
+        // 同名的指标（不同标签）紧接着输出
+        for (size_t j = i; j < metrics_.size(); j++)
+        {
+            const Metric &metric = *metrics_[j];
+            if (done[j] || metric.name != head.name)
+            {
+                continue;
+            }
+            done[j] = true;
+            char value[64];
+            if (metric.fn)
+            {
+                snprintf(value, sizeof(value), "%.10g", metric.fn());
+            }
+            else if (metric.type == TYPE_COUNTER)
+            {
+                snprintf(value, sizeof(value), "%llu", static_cast<unsigned long long>(metric.counter->Value()));
+            }
+            else if (metric.type == TYPE_GAUGE)
+            {
+                snprintf(value, sizeof(value), "%lld", static_cast<long long>(metric.gauge->Value()));
+            }
+            else
+            {
+                RenderHistogram_(out, metric);
+                continue;
+            }
+            AppendSample(out, metric.name, metric.labels, value);
+        }
+    }
+    return out;
+}
@@ -0,0 +1,160 @@
+//
+// 运行指标：计数器和直方图按线程分片，记录只改本线程所在分片（一次无竞争的原子加），
+// 读取时汇总；注册表按 Prometheus 文本格式输出所有指标
+//
+#ifndef METRICS_H
+#define METRICS_H
+
+#include <atomic>
+#include <mutex>
+#include <string>
+#include <vector>
+#include <memory>
+#include <functional>
+#include <cstdint>
+#include "histogram.h"
+
+class MetricShard
+{
+public:
+    static const int COUNT = 16;
+    static const size_t CACHE_LINE = 64;
+
+    // 线程首次记录时分配分片，之后只读线程局部变量
+    static int Index()
+    {
+        static thread_local int index = -1;
+        if (index < 0)
+        {
+            index = next_.fetch_add(1, std::memory_order_relaxed) % COUNT;
+        }
+        return index;
+    }
+
+private:
+    static std::atomic<int> next_;
+};
+
+class MetricCounter
+{
+public:
+    MetricCounter()
+    {
+        for (auto &cell : cells_)
+        {
+            cell.value = 0;
+        }
+    }
+
+    void Add(uint64_t n = 1) { cells_[MetricShard::Index()].value.fetch_add(n, std::memory_order_relaxed); }
+
+    uint64_t Value() const
+    {
+        uint64_t sum = 0;
+        for (auto &cell : cells_)
+        {
+            sum += cell.value.load(std::memory_order_relaxed);
+        }
+        return sum;
+    }
+
+private:
+    // 按缓存行间隔排列，不依赖对象本身的对齐
+    struct Cell
+    {
+        std::atomic<uint64_t> value;
+        char pad[MetricShard::CACHE_LINE - sizeof(std::atomic<uint64_t>)];
+    };
+    Cell cells_[MetricShard::COUNT];
+};
+
+// 瞬时值，由单个线程周期性设置或少量增减
+class MetricGauge
+{
+public:
+    MetricGauge() : value_(0) {}
+    void Set(int64_t v) { value_.store(v, std::memory_order_relaxed); }
+    void Add(int64_t n) { value_.fetch_add(n, std::memory_order_relaxed); }
+    int64_t Value() const { return value_.load(std::memory_order_relaxed); }
+
+private:
+    std::atomic<int64_t> value_;
+};
+
+// 分片的 LatencyHistogram，接口与之相同
+class MetricHistogram
+{
+public:
+    static const int BUCKETS = LatencyHistogram::BUCKETS;
+
+    void Record(int64_t us) { shards_[MetricShard::Index()].hist.Record(us); }
+
+    uint64_t Count() const;
+    uint64_t SumUs() const;
+    uint64_t BucketCount(int i) const;
+    static int64_t BucketUpperUs(int i) { return LatencyHistogram::BucketUpperUs(i); }
+    int64_t Percentile(double p) const; // 返回 p 分位（0~1）所在桶的上界（微秒）
+
+private:
+    struct Shard
+    {
+        LatencyHistogram hist;
+        char pad[MetricShard::CACHE_LINE];
+    };
+    Shard shards_[MetricShard::COUNT];
+};
+
+class MetricsRegistry
+{
+public:
+    static MetricsRegistry *Instance();
+
+    // 同名同标签重复注册返回同一个对象，对象在进程内一直有效；labels 形如 code="200"
+    MetricCounter *Counter(const std::string &name, const std::string &help, const std::string &labels = "");
+    MetricGauge *Gauge(const std::string &name, const std::string &help, const std::string &labels = "");
+    MetricHistogram *Histogram(const std::string &name, const std::string &help, const std::string &labels = "");
+
+    // 抓取时才计算的指标，owner 析构前需调用 RemoveCallbacks
+    void CounterFunc(const std::string &name, const std::string &help, const std::string &labels,
+                     std::function<double()> fn, const void *owner);
+    void GaugeFunc(const std::string &name, const std::string &help, const std::string &labels,
+                   std::function<double()> fn, const void *owner);
+    void RemoveCallbacks(const void *owner);
+
+    std::string Render() const; // Prometheus 文本格式 0.0.4
+
+private:
+    enum TYPE
+    {
+        TYPE_COUNTER = 0,
+        TYPE_GAUGE,
+        TYPE_HISTOGRAM,
+    };
+
+    struct Metric
+    {
+        std::string name;
+        std::string help;
+        std::string labels;
+        TYPE type;
+        std::unique_ptr<MetricCounter> counter;
+        std::unique_ptr<MetricGauge> gauge;
+        std::unique_ptr<MetricHistogram> histogram;
+        std::function<double()> fn; // 回调指标
+        const void *owner;
+    };
+
+    // 输出到 2^26us（约 67 秒）为止的桶，更大的只计入 +Inf
+    static const int EXPORT_MAX_EXP = 25;
+    static const int EXPORT_BUCKETS = LatencyHistogram::SUB_BUCKETS +
+                                      (EXPORT_MAX_EXP - LatencyHistogram::SUB_BITS + 1) * LatencyHistogram::SUB_BUCKETS;
+
+    Metric *Find_(const std::string &name, const std::string &labels, TYPE type); // 需持有 mtx_
+    Metric *Add_(const std::string &name, const std::string &help, const std::string &labels, TYPE type);
+    static void RenderHistogram_(std::string &out, const Metric &metric);
+
+    mutable std::mutex mtx_;
+    std::vector<std::unique_ptr<Metric>> metrics_; // 按注册顺序输出，同名指标归为一组
+};
+
+#endif
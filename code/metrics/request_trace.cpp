@@ -0,0 +1,184 @@
+#include "request_trace.h"
+#include <cstdio>
+#include <arpa/inet.h>
+#include "../log/log.h"
+
+namespace
+{
+    // 路由 -> 直方图的线程私有缓存，命中时不取锁；直方图由注册表持有，不会失效
+    thread_local std::unordered_map<std::string, MetricHistogram *> routeCache;
+
+    // Prometheus 标签值转义
+    std::string EscapeLabel(const std::string &value)
+    {
+        std::string out;
+        out.reserve(value.size());
+        for (char c : value)
+        {
+            if (c == '\\' || c == '"')
+            {
+                out += '\\';
+                out += c;
+            }
+            else if (c == '\n')
+            {
+                out += "\\n";
+            }
+            else
+            {
+                out += c;
+            }
+        }
+        return out;
+    }
+}
+
+RequestTracer *RequestTracer::Instance()
+{
+    static RequestTracer tracer;
+    return &tracer;
+}
+
+RequestTracer::RequestTracer() : enabled_(false), slowNs_(0), exemplarSec_(0), exemplarCount_(0)
+{
+    MetricsRegistry *registry = MetricsRegistry::Instance();
+    stages_[RequestTrace::ACCEPT] = nullptr;
+    for (int i = RequestTrace::ACCEPT + 1; i < RequestTrace::PHASE_COUNT; i++)
+    {
+        stages_[i] = registry->Histogram("webserver_request_stage_seconds", "Time spent in each request stage.",
+                                         std::string("stage=\"") + StageName(i) + "\"");
+    }
+    slow_ = registry->Counter("webserver_slow_requests_total", "Requests slower than the slow request threshold.");
+}
+
+const char *RequestTracer::StageName(int phase)
+{
+    switch (phase)
+    {
+    case RequestTrace::DISPATCH:
+        return "accept_wait";
+    case RequestTrace::DEQUEUE:
+        return "queue";
+    case RequestTrace::READ:
+        return "read";
+    case RequestTrace::PARSED:
+        return "parse";
+    case RequestTrace::DB_DONE:
+        return "db";
+    case RequestTrace::HANDLED:
+        return "handle";
+    case RequestTrace::FIRST_WRITE:
+        return "first_write";
+    case RequestTrace::LAST_WRITE:
+        return "send";
+    default:
+        return "accept";
+    }
+}
+
+void RequestTracer::Enable(int slowMs)
+{
+    slowNs_ = static_cast<int64_t>(slowMs) * 1000000;
+    enabled_ = true;
+}
+
+MetricHistogram *RequestTracer::Route_(const std::string &route)
+{
+    auto it = routeCache.find(route);
+    if (it != routeCache.end())
+    {
+        return it->second;
+    }
+    MetricHistogram *hist;
+    {
+        std::lock_guard<std::mutex> locker(routesMtx_);
+        auto found = routes_.find(route);
+        if (found != routes_.end())
+        {
+            hist = found->second;
+        }
+        else
+        {
+            std::string label = routes_.size() < MAX_ROUTES ? route : "other";
+            hist = MetricsRegistry::Instance()->Histogram("webserver_route_duration_seconds",
+                                                          "Request time from dispatch to last byte written, by route.",
+                                                          "route=\"" + EscapeLabel(label) + "\"");
+            routes_[route] = hist; //超出上限的路由也记下，之后直接命中 "other"
+        }
+    }
+    routeCache[route] = hist;
+    return hist;
+}
+
+bool RequestTracer::TakeExemplar_(int64_t nowNs)
+{
+    int64_t sec = nowNs / 1000000000;
+    int64_t last = exemplarSec_.load(std::memory_order_relaxed);
+    if (sec != last && exemplarSec_.compare_exchange_strong(last, sec))
+    {
+        exemplarCount_ = 0;
+    }
+    return exemplarCount_.fetch_add(1, std::memory_order_relaxed) < EXEMPLARS_PER_SEC;
+}
+
+void RequestTracer::Finish(const RequestTrace &trace, const std::string &route, int status, uint32_t ip)
+{
+    // 相邻两个经过的阶段之间的时间记到后一个阶段名下
+    int prev = -1;
+    int start = -1; //总耗时从分派开始算，不含连接建立后客户端发送请求前的空闲
+    for (int i = 0; i < RequestTrace::PHASE_COUNT; i++)
+    {
+        if (!trace.ts[i])
+        {
+            continue;
+        }
+        if (prev >= 0)
+        {
+            stages_[i]->Record((trace.ts[i] - trace.ts[prev]) / 1000);
+        }
+        if (start < 0 && i != RequestTrace::ACCEPT)
+        {
+            start = i;
+        }
+        prev = i;
+    }
+    if (start < 0 || prev <= start)
+    {
+        return;
+    }
+    int64_t totalNs = trace.ts[prev] - trace.ts[start];
+    Route_(status < 400 ? route : "other")->Record(totalNs / 1000);
+
+    if (totalNs < slowNs_.load(std::memory_order_relaxed))
+    {
+        return;
+    }
+    slow_->Add();
+    if (!TakeExemplar_(trace.ts[prev]))
+    {
+        return;
+    }
+    char stages[256];
+    size_t n = 0;
+    prev = -1;
+    for (int i = 0; i < RequestTrace::PHASE_COUNT && n < sizeof(stages); i++)
+    {
+        if (!trace.ts[i])
+        {
+            continue;
+        }
+        if (prev >= 0)
+        {
+            n += snprintf(stages + n, sizeof(stages) - n, " %s:%lld", StageName(i),
+                          static_cast<long long>((trace.ts[i] - trace.ts[prev]) / 1000));
+        }
+        prev = i;
+    }
+    stages[sizeof(stages) - 1] = '\0';
+    char client[INET_ADDRSTRLEN];
+    struct in_addr addr;
+    addr.s_addr = ip;
+    inet_ntop(AF_INET, &addr, client, sizeof(client));
+    LOG_WARN("Slow request %lldus %s status:%d client:%s stages(us):%s", static_cast<long long>(totalNs / 1000),
+             route.c_str(), status, client, stages);
+}
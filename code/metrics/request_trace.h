@@ -0,0 +1,96 @@
+//
+// 请求阶段追踪：请求经过的每个阶段记一个单调时钟时间戳，
+// 完成时按阶段、按路由记入直方图，总耗时超过阈值的请求输出一条各阶段耗时的样例
+//
+#ifndef REQUEST_TRACE_H
+#define REQUEST_TRACE_H
+
+#include <atomic>
+#include <mutex>
+#include <string>
+#include <chrono>
+#include <cstdint>
+#include <cstring>
+#include <unordered_map>
+#include "metrics.h"
+
+struct RequestTrace
+{
+    enum PHASE // 按发生顺序排列，没有经过的阶段时间戳为 0
+    {
+        ACCEPT = 0,  // 连接建立，只有连接上的第一个请求有
+        DISPATCH,    // 事件循环收到读事件并分派
+        DEQUEUE,     // 工作线程取出任务
+        READ,        // 读到请求数据；流水线中后续请求为开始处理的时间
+        PARSED,      // 解析完成
+        DB_DONE,     // 数据库校验完成，只有登录/注册有
+        HANDLED,     // 响应生成（含打开/映射文件）
+        FIRST_WRITE, // 第一次写出数据
+        LAST_WRITE,  // 全部写出
+        PHASE_COUNT,
+    };
+
+    int64_t ts[PHASE_COUNT];
+
+    RequestTrace() { Clear(); }
+    void Clear() { memset(ts, 0, sizeof(ts)); }
+    bool Has(PHASE phase) const { return ts[phase] != 0; }
+    void Set(PHASE phase, std::chrono::steady_clock::time_point t) { ts[phase] = ToNs(t); }
+    void Mark(PHASE phase) { ts[phase] = NowNs(); }
+    void MarkOnce(PHASE phase)
+    {
+        if (ts[phase] == 0)
+        {
+            Mark(phase);
+        }
+    }
+
+    // 两个阶段之间的微秒数，任一阶段没有经过时为 0
+    int64_t Us(PHASE from, PHASE to) const
+    {
+        return ts[from] && ts[to] ? (ts[to] - ts[from]) / 1000 : 0;
+    }
+
+    // steady_clock 即 CLOCK_MONOTONIC，经 vDSO 读取
+    static int64_t NowNs() { return ToNs(std::chrono::steady_clock::now()); }
+    static int64_t ToNs(std::chrono::steady_clock::time_point t)
+    {
+        return std::chrono::duration_cast<std::chrono::nanoseconds>(t.time_since_epoch()).count();
+    }
+};
+
+class RequestTracer
+{
+public:
+    static RequestTracer *Instance();
+
+    void Enable(int slowMs); // 总耗时超过 slowMs 的请求输出样例
+    bool IsEnabled() const { return enabled_.load(std::memory_order_relaxed); }
+
+    // 请求全部写出后调用，route 为请求路径，错误响应归入 "other"；ip 为网络字节序，只在输出样例时格式化
+    void Finish(const RequestTrace &trace, const std::string &route, int status, uint32_t ip);
+
+    static const char *StageName(int phase); // 以 phase 结束的阶段名
+
+private:
+    RequestTracer();
+
+    MetricHistogram *Route_(const std::string &route);
+    bool TakeExemplar_(int64_t nowNs); // 每秒最多输出 EXEMPLARS_PER_SEC 条样例
+
+    static const int MAX_ROUTES = 64; // 路由标签上限，超出后归入 "other"
+    static const int EXEMPLARS_PER_SEC = 10;
+
+    std::atomic<bool> enabled_;
+    std::atomic<int64_t> slowNs_;
+    MetricHistogram *stages_[RequestTrace::PHASE_COUNT];
+    MetricCounter *slow_;
+
+    std::mutex routesMtx_;
+    std::unordered_map<std::string, MetricHistogram *> routes_;
+
+    std::atomic<int64_t> exemplarSec_;
+    std::atomic<int> exemplarCount_;
+};
+
+#endif
@@ -0,0 +1,387 @@
+#include "sql_async.h"
+#include <cassert>
+#include <algorithm>
+
+AsyncSqlClient::~AsyncSqlClient()
+{
+    Close();
+}
+
+bool AsyncSqlClient::Init(const char *host, int port,
+                          const char *user, const char *pwd,
+                          const char *dbName, int connSize, const AddFdFunc &addFd,
+                          size_t maxPending)
+{
+    assert(connSize > 0 && addFd);
+#ifndef HAVE_MYSQL_NONBLOCKING
+    LOG_ERROR("AsyncSqlClient requires MySQL client 8.0.16+ non-blocking API!");
+    return false;
+#endif
+    host_ = host;
+    user_ = user;
+    pwd_ = pwd;
+    dbName_ = dbName;
+    port_ = port;
+    maxPending_ = maxPending;
+    conns_.resize(connSize);
+    for (int i = 0; i < connSize; i++)
+    {
+        Conn &conn = conns_[i];
+        // 启动时同步建立连接，之后的查询全部走非阻塞接口
+        conn.sql = Connect_();
+        if (!conn.sql)
+        {
+            conn.state = BROKEN;
+            continue;
+        }
+        conn.fd = conn.sql->net.fd;
+        if (conn.fd < 0 || !addFd(conn.fd))
+        {
+            LOG_ERROR("async mysql add fd error!");
+            mysql_close(conn.sql);
+            conn.sql = nullptr;
+            conn.fd = -1;
+            conn.state = BROKEN;
+            continue;
+        }
+        fdIndex_[conn.fd] = i;
+        alive_++;
+    }
+    // 一条都没连上也保留客户端，EnableReconnect 后由后台线程继续尝试，期间登录走数据库通道
+    LOG_INFO("AsyncSqlClient ready conns: %d/%d", (int)fdIndex_.size(), connSize);
+    return true;
+}
+
+void AsyncSqlClient::EnableReconnect(const AddFdFunc &addFd, const RunInLoopFunc &runInLoop)
+{
+    assert(addFd && runInLoop && !reconnector_.joinable());
+    addFd_ = addFd;
+    runInLoop_ = runInLoop;
+    reconnector_ = std::thread(&AsyncSqlClient::ReconnectLoop_, this);
+    for (size_t i = 0; i < conns_.size(); i++)
+    {
+        if (conns_[i].state == BROKEN)
+        {
+            ScheduleReconnect_(i, RECONNECT_MIN_MS);
+        }
+    }
+}
+
+void AsyncSqlClient::Close()
+{
+    {
+        std::lock_guard<std::mutex> locker(reconnectMtx_);
+        stop_ = true;
+        reconnectTasks_.clear();
+    }
+    reconnectCond_.notify_all();
+    if (reconnector_.joinable())
+    {
+        reconnector_.join();
+    }
+    for (auto &conn : conns_)
+    {
+        if (conn.sql)
+        {
+            mysql_close(conn.sql);
+            conn.sql = nullptr;
+        }
+    }
+    conns_.clear();
+    fdIndex_.clear();
+    alive_ = 0;
+}
+
+MYSQL *AsyncSqlClient::Connect_() const
+{
+    MYSQL *sql = mysql_init(nullptr);
+    assert(sql);
+    // 重连在后台线程阻塞进行，超时不宜过长，以免关闭时久等
+    unsigned int timeout = CONNECT_TIMEOUT_S;
+    mysql_options(sql, MYSQL_OPT_CONNECT_TIMEOUT, &timeout);
+    if (!mysql_real_connect(sql, host_.c_str(), user_.c_str(), pwd_.c_str(), dbName_.c_str(), port_, nullptr, 0))
+    {
+        LOG_ERROR("async mysql connect error: %s", mysql_error(sql));
+        mysql_close(sql);
+        return nullptr;
+    }
+    return sql;
+}
+
+std::string AsyncSqlClient::Escape(const std::string &str)
+{
+    for (auto &conn : conns_)
+    {
+        if (conn.state != BROKEN)
+        {
+            std::string esc(str.size() * 2 + 1, '\0');
+            unsigned long len = mysql_real_escape_string(conn.sql, &esc[0], str.c_str(), str.size());
+            esc.resize(len);
+            return esc;
+        }
+    }
+    return "";
+}
+
+bool AsyncSqlClient::Query(const std::string &sql, const QueryCallBack &cb, const Deadline &deadline)
+{
+    for (auto &conn : conns_)
+    {
+        if (conn.state == IDLE)
+        {
+            Start_(conn, {sql, cb, deadline});
+            return true;
+        }
+    }
+    if (alive_ == 0 || pending_.size() >= maxPending_)
+    {
+        return false;
+    }
+    pending_.push({sql, cb, deadline});
+    return true;
+}
+
+void AsyncSqlClient::OnEvent(int fd)
+{
+    auto it = fdIndex_.find(fd);
+    assert(it != fdIndex_.end());
+    Conn &conn = conns_[it->second];
+    if (conn.state == IDLE)
+    {
+        // 空闲连接可读通常是服务端断开，关闭后 fd 自动从 epoll 中移除
+        LOG_WARN("async mysql conn[%d] closed by server", fd);
+        MarkBroken_(conn);
+        return;
+    }
+    Step_(conn);
+}
+
+void AsyncSqlClient::Start_(Conn &conn, Request &&req)
+{
+    conn.req = std::move(req);
+    conn.state = QUERYING;
+    inFlight_++;
+    Step_(conn);
+}
+
+void AsyncSqlClient::Step_(Conn &conn)
+{
+#ifdef HAVE_MYSQL_NONBLOCKING
+    if (conn.state == QUERYING)
+    {
+        net_async_status status = mysql_real_query_nonblocking(conn.sql, conn.req.sql.c_str(), conn.req.sql.size());
+        if (status == NET_ASYNC_NOT_READY)
+        {
+            // 可能卡在发送上，只有可写事件能推进；边沿触发，等待响应期间不会因一直可写而反复唤醒
+            Watch_(conn, EPOLLIN | EPOLLOUT | EPOLLET);
+            return;
+        }
+        if (status == NET_ASYNC_ERROR)
+        {
+            // 出错后非阻塞状态机的状态不可靠，一律断开重连；先断开，排队的查询不会被派到这条连接上
+            LOG_ERROR("async query error(%u): %s", mysql_errno(conn.sql), mysql_error(conn.sql));
+            MarkBroken_(conn);
+            Finish_(conn, nullptr);
+            return;
+        }
+        Watch_(conn, EPOLLIN);
+        conn.state = STORING;
+    }
+    if (conn.state == STORING)
+    {
+        MYSQL_RES *res = nullptr;
+        net_async_status status = mysql_store_result_nonblocking(conn.sql, &res);
+        if (status == NET_ASYNC_NOT_READY)
+        {
+            return;
+        }
+        if (status == NET_ASYNC_ERROR)
+        {
+            LOG_ERROR("async store result error(%u): %s", mysql_errno(conn.sql), mysql_error(conn.sql));
+            MarkBroken_(conn);
+            res = nullptr;
+        }
+        Finish_(conn, res);
+    }
+#else
+    Finish_(conn, nullptr);
+#endif
+}
+
+void AsyncSqlClient::Watch_(Conn &conn, uint32_t events)
+{
+    if (modFd_ && conn.events != events && modFd_(conn.fd, events))
+    {
+        conn.events = events;
+    }
+}
+
+void AsyncSqlClient::Finish_(Conn &conn, MYSQL_RES *res)
+{
+    QueryCallBack cb = std::move(conn.req.cb);
+    conn.req = Request();
+    if (conn.state != BROKEN)
+    {
+        conn.state = IDLE;
+    }
+    inFlight_--;
+    if (res)
+    {
+        conn.backoffMs = RECONNECT_MIN_MS;
+    }
+    cb(res);
+    if (res)
+    {
+        mysql_free_result(res);
+    }
+    StartPending_();
+}
+
+// 关闭连接（fd 随之从 epoll 中移除）并安排重连；进行中的查询由调用方回调
+void AsyncSqlClient::MarkBroken_(Conn &conn)
+{
+    if (conn.state == BROKEN)
+    {
+        return;
+    }
+    fdIndex_.erase(conn.fd);
+    mysql_close(conn.sql);
+    conn.sql = nullptr;
+    conn.fd = -1;
+    conn.state = BROKEN;
+    if (runInLoop_)
+    {
+        ScheduleReconnect_(static_cast<size_t>(&conn - conns_.data()), conn.backoffMs);
+    }
+    if (--alive_ == 0)
+    {
+        LOG_WARN("AsyncSqlClient has no live connection");
+        FailPending_();
+    }
+}
+
+void AsyncSqlClient::FailPending_()
+{
+    std::queue<Request> failed;
+    failed.swap(pending_);
+    while (!failed.empty())
+    {
+        failed.front().cb(nullptr);
+        failed.pop();
+    }
+}
+
+void AsyncSqlClient::ScheduleReconnect_(size_t index, int backoffMs)
+{
+    {
+        std::lock_guard<std::mutex> locker(reconnectMtx_);
+        if (stop_)
+        {
+            return;
+        }
+        reconnectTasks_.push_back({index, backoffMs, std::chrono::steady_clock::now() + std::chrono::milliseconds(backoffMs)});
+    }
+    reconnectCond_.notify_one();
+}
+
+// 后台线程：按到期时间依次重连，失败的连接退避间隔翻倍
+void AsyncSqlClient::ReconnectLoop_()
+{
+    std::unique_lock<std::mutex> locker(reconnectMtx_);
+    while (!stop_)
+    {
+        if (reconnectTasks_.empty())
+        {
+            reconnectCond_.wait(locker);
+            continue;
+        }
+        auto first = std::min_element(reconnectTasks_.begin(), reconnectTasks_.end(),
+                                      [](const ReconnectTask &a, const ReconnectTask &b)
+                                      { return a.due < b.due; });
+        if (first->due > std::chrono::steady_clock::now())
+        {
+            reconnectCond_.wait_until(locker, first->due);
+            continue;
+        }
+        ReconnectTask task = *first;
+        reconnectTasks_.erase(first);
+
+        locker.unlock();
+        MYSQL *sql = Connect_();
+        locker.lock();
+        if (stop_)
+        {
+            if (sql)
+            {
+                mysql_close(sql);
+            }
+            break;
+        }
+        int next = task.backoffMs * 2 > RECONNECT_MAX_MS ? RECONNECT_MAX_MS : task.backoffMs * 2;
+        if (!sql)
+        {
+            reconnectTasks_.push_back({task.index, next, std::chrono::steady_clock::now() + std::chrono::milliseconds(next)});
+            continue;
+        }
+        // 新连接带着加倍后的间隔，成功完成一次查询后才恢复最小间隔，避免连上即断时频繁重连
+        runInLoop_([this, task, sql, next]
+                   { Adopt_(task.index, sql, next); });
+    }
+}
+
+void AsyncSqlClient::Adopt_(size_t index, MYSQL *sql, int backoffMs)
+{
+    if (index >= conns_.size() || conns_[index].state != BROKEN)
+    {
+        mysql_close(sql); // 已关闭
+        return;
+    }
+    Conn &conn = conns_[index];
+    int fd = sql->net.fd;
+    if (fd < 0 || !addFd_(fd))
+    {
+        LOG_ERROR("async mysql add fd error!");
+        mysql_close(sql);
+        ScheduleReconnect_(index, backoffMs);
+        return;
+    }
+    conn.sql = sql;
+    conn.fd = fd;
+    conn.state = IDLE;
+    conn.events = EPOLLIN;
+    conn.backoffMs = backoffMs;
+    fdIndex_[fd] = index;
+    alive_++;
+    LOG_INFO("async mysql conn[%d] reconnected, live conns: %d", fd, alive_.load());
+    StartPending_();
+}
+
+void AsyncSqlClient::StartPending_()
+{
+    std::vector<Request> expired;
+    for (auto &conn : conns_)
+    {
+        if (conn.state != IDLE)
+        {
+            continue;
+        }
+        // 排队期间已过期的查询不再占用连接
+        while (!pending_.empty() && pending_.front().deadline.Expired())
+        {
+            expired.push_back(std::move(pending_.front()));
+            pending_.pop();
+        }
+        if (pending_.empty())
+        {
+            break;
+        }
+        Request req = std::move(pending_.front());
+        pending_.pop();
+        Start_(conn, std::move(req));
+    }
+    for (auto &req : expired)
+    {
+        Deadline::CountExpired(Deadline::DB_QUEUE);
+        req.cb(nullptr);
+    }
+}
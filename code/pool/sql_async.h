@@ -0,0 +1,137 @@
+//
+// 基于 MySQL 非阻塞 API（8.0.16+）的异步查询客户端
+// 连接 fd 注册到服务器的 Epoll 中，除 LiveConns 外所有接口都只能在事件循环线程调用
+// 断开的连接由后台线程按退避间隔重连，连上后投递回事件循环重新启用
+//
+#ifndef SQL_ASYNC_H
+#define SQL_ASYNC_H
+
+#include <mysql/mysql.h>
+#include <mysql/errmsg.h>
+#include <sys/epoll.h>
+#include <string>
+#include <vector>
+#include <queue>
+#include <functional>
+#include <unordered_map>
+#include <atomic>
+#include <mutex>
+#include <thread>
+#include <chrono>
+#include <condition_variable>
+#include "../log/log.h"
+#include "../timer/deadline.h"
+
+// 非阻塞 API 仅 MySQL 8.0.16 及以上的客户端库提供，MariaDB 的兼容库没有
+#if !defined(MARIADB_BASE_VERSION) && defined(MYSQL_VERSION_ID) && MYSQL_VERSION_ID >= 80016
+#define HAVE_MYSQL_NONBLOCKING 1
+#endif
+
+class AsyncSqlClient
+{
+public:
+    typedef std::function<void(MYSQL_RES *res)> QueryCallBack; // res 为 nullptr 表示查询失败或排队期间过期，回调返回后结果集被释放
+    typedef std::function<bool(int fd)> AddFdFunc;              // 把连接 fd 注册进事件循环（EPOLLIN）
+    typedef std::function<bool(int fd, uint32_t events)> ModFdFunc; // 修改连接 fd 关注的事件
+    typedef std::function<void(std::function<void()>)> RunInLoopFunc; // 把任务投递到事件循环线程执行
+
+    AsyncSqlClient() = default;
+    ~AsyncSqlClient();
+
+    // 客户端库不支持非阻塞 API 时返回 false；连不上的连接标记为断开，等待重连
+    bool Init(const char *host, int port,
+              const char *user, const char *pwd,
+              const char *dbName, int connSize, const AddFdFunc &addFd,
+              size_t maxPending = 1024);
+    void Close();
+
+    // 启用断线重连，addFd 在事件循环线程中调用；Init 时没连上的连接也会开始重连
+    void EnableReconnect(const AddFdFunc &addFd, const RunInLoopFunc &runInLoop);
+
+    // 查询发送被阻塞时需要 EPOLLOUT 才能继续，设置后由客户端在发送期间切换关注的事件
+    void SetModFd(const ModFdFunc &modFd) { modFd_ = modFd; }
+
+    // 没有可用连接或排队已满返回 false；排队到 deadline 仍未发出的查询不再发送，计入 DB_QUEUE 过期
+    bool Query(const std::string &sql, const QueryCallBack &cb, const Deadline &deadline = Deadline());
+    std::string Escape(const std::string &str);
+
+    bool Owns(int fd) const { return fdIndex_.count(fd) > 0; }
+    void OnEvent(int fd); // 连接 fd 就绪，继续推进查询状态机
+
+    size_t InFlight() const { return inFlight_; }
+    size_t Pending() const { return pending_.size(); }
+    int LiveConns() const { return alive_.load(std::memory_order_acquire); } // 任意线程可调用
+
+    AsyncSqlClient(const AsyncSqlClient &) = delete;
+    AsyncSqlClient &operator=(const AsyncSqlClient &) = delete;
+
+private:
+    enum CONN_STATE
+    {
+        IDLE,
+        QUERYING,
+        STORING,
+        BROKEN,
+    };
+
+    struct Request
+    {
+        std::string sql;
+        QueryCallBack cb;
+        Deadline deadline;
+    };
+
+    struct Conn
+    {
+        MYSQL *sql = nullptr;
+        int fd = -1;
+        CONN_STATE state = IDLE;
+        uint32_t events = EPOLLIN; // 当前关注的事件
+        Request req;
+        int backoffMs = RECONNECT_MIN_MS; // 下次重连失败后的等待
+    };
+
+    struct ReconnectTask
+    {
+        size_t index;
+        int backoffMs;
+        std::chrono::steady_clock::time_point due;
+    };
+
+    static const int RECONNECT_MIN_MS = 100;
+    static const int RECONNECT_MAX_MS = 5000;
+    static const unsigned int CONNECT_TIMEOUT_S = 2;
+
+    MYSQL *Connect_() const; // 阻塞建立一条连接，失败返回 nullptr
+    void Start_(Conn &conn, Request &&req);
+    void Step_(Conn &conn);
+    void Watch_(Conn &conn, uint32_t events);
+    void Finish_(Conn &conn, MYSQL_RES *res);
+    void StartPending_();
+    void FailPending_(); // 没有可用连接时，排队的查询全部以失败回调
+    void MarkBroken_(Conn &conn);
+    void ScheduleReconnect_(size_t index, int backoffMs);
+    void Adopt_(size_t index, MYSQL *sql, int backoffMs); // 事件循环线程：启用重连成功的连接
+    void ReconnectLoop_();
+
+    std::string host_, user_, pwd_, dbName_;
+    int port_ = 0;
+
+    std::vector<Conn> conns_;
+    std::unordered_map<int, size_t> fdIndex_; // fd -> conns_ 下标
+    std::queue<Request> pending_;
+    size_t maxPending_ = 0;
+    size_t inFlight_ = 0;
+    std::atomic<int> alive_{0}; // 可用连接数
+
+    AddFdFunc addFd_;
+    ModFdFunc modFd_;
+    RunInLoopFunc runInLoop_;
+    std::thread reconnector_;
+    std::mutex reconnectMtx_;
+    std::condition_variable reconnectCond_;
+    std::vector<ReconnectTask> reconnectTasks_;
+    bool stop_ = false;
+};
+
+#endif
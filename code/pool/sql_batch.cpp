@@ -0,0 +1,235 @@
+#include "sql_batch.h"
+#include "sql_connect_RAII.h"
+#include <mysql/errmsg.h>
+#include <mysql/mysqld_error.h>
+#include <unordered_set>
+#include <cassert>
+#include <cstring>
+
+SqlInsertBatcher::~SqlInsertBatcher()
+{
+    Close();
+}
+
+void SqlInsertBatcher::Init(SqlConnPool *connPool, size_t maxBatch, int maxDelayMs)
+{
+    assert(connPool && maxBatch > 0 && maxDelayMs >= 0);
+    connPool_ = connPool;
+    maxBatch_ = maxBatch;
+    maxDelay_ = std::chrono::milliseconds(maxDelayMs);
+    isClose_ = false;
+    committer_ = std::thread(&SqlInsertBatcher::Run_, this);
+}
+
+void SqlInsertBatcher::Close()
+{
+    {
+        std::lock_guard<std::mutex> locker(mtx_);
+        if (isClose_)
+        {
+            return;
+        }
+        isClose_ = true;
+    }
+    cond_.notify_all();
+    if (committer_.joinable())
+    {
+        committer_.join();
+    }
+}
+
+const unsigned int SqlInsertBatcher::EXPIRED;
+
+unsigned int SqlInsertBatcher::Insert(const std::string &name, const std::string &pwd, const Deadline &deadline)
+{
+    Row row{&name, &pwd, &deadline, Clock::now(), 0, false};
+    std::unique_lock<std::mutex> locker(mtx_);
+    if (isClose_)
+    {
+        return CR_UNKNOWN_ERROR;
+    }
+    pending_.push_back(&row);
+    if (pending_.size() == 1 || pending_.size() >= maxBatch_)
+    {
+        cond_.notify_one();
+    }
+    doneCond_.wait(locker, [&row]
+                   { return row.done; });
+    return row.err;
+}
+
+SqlInsertBatcher::Stats SqlInsertBatcher::GetStats()
+{
+    std::lock_guard<std::mutex> locker(mtx_);
+    Stats stats{};
+    stats.batches = batches_;
+    stats.rows = rows_;
+    stats.fallbacks = fallbacks_;
+    stats.pending = pending_.size();
+    return stats;
+}
+
+void SqlInsertBatcher::Run_()
+{
+    std::vector<Row *> batch;
+    std::unique_lock<std::mutex> locker(mtx_);
+    while (true)
+    {
+        // 关闭时也把剩余的行提交完，保证没有请求线程永久等待
+        if (pending_.empty())
+        {
+            if (isClose_)
+            {
+                break;
+            }
+            cond_.wait(locker);
+            continue;
+        }
+        // 批次未满时最多等到最早一行入队后 maxDelay_
+        Clock::time_point deadline = pending_.front()->enqueued + maxDelay_;
+        if (pending_.size() < maxBatch_ && !isClose_ && Clock::now() < deadline)
+        {
+            cond_.wait_until(locker, deadline);
+            continue;
+        }
+        while (!pending_.empty() && batch.size() < maxBatch_)
+        {
+            batch.push_back(pending_.front());
+            pending_.pop_front();
+        }
+        locker.unlock();
+        Flush_(batch);
+        locker.lock();
+        for (Row *row : batch)
+        {
+            row->done = true;
+        }
+        batches_++;
+        rows_ += batch.size();
+        batch.clear();
+        doneCond_.notify_all();
+    }
+}
+
+void SqlInsertBatcher::Flush_(std::vector<Row *> &batch)
+{
+    // 跳过已过期的行；同一批次内重复的用户名只插入第一行
+    std::vector<Row *> rows;
+    std::unordered_set<std::string> names;
+    for (Row *row : batch)
+    {
+        if (row->deadline->Expired())
+        {
+            Deadline::CountExpired(Deadline::DB_QUERY);
+            row->err = EXPIRED;
+        }
+        else if (names.insert(*row->name).second)
+        {
+            rows.push_back(row);
+        }
+        else
+        {
+            row->err = ER_DUP_ENTRY;
+        }
+    }
+
+    if (rows.empty())
+    {
+        return;
+    }
+    MYSQL *sql = nullptr;
+    SqlConnRAII connRAII(&sql, connPool_);
+    if (!sql)
+    {
+        for (Row *row : rows)
+        {
+            row->err = CR_SERVER_GONE_ERROR;
+        }
+        return;
+    }
+    FlushRows_(sql, rows);
+}
+
+void SqlInsertBatcher::FlushRows_(MYSQL *sql, std::vector<Row *> &rows)
+{
+    SqlStmtCache *stmts = connPool_->GetStmtCache(sql);
+    if (!stmts)
+    {
+        for (Row *row : rows)
+        {
+            row->err = CR_UNKNOWN_ERROR;
+        }
+        return;
+    }
+    // 每行依次绑定用户名和密码，多行语句与逐行重试共用
+    std::vector<MYSQL_BIND> params(rows.size() * 2);
+    std::vector<unsigned long> lens(rows.size() * 2);
+    for (size_t i = 0; i < rows.size(); i++)
+    {
+        const std::string *fields[2] = {rows[i]->name, rows[i]->pwd};
+        for (int j = 0; j < 2; j++)
+        {
+            MYSQL_BIND &param = params[i * 2 + j];
+            memset(&param, 0, sizeof(param));
+            lens[i * 2 + j] = fields[j]->size();
+            param.buffer_type = MYSQL_TYPE_STRING;
+            param.buffer = const_cast<char *>(fields[j]->data());
+            param.buffer_length = lens[i * 2 + j];
+            param.length = &lens[i * 2 + j];
+        }
+    }
+
+    MYSQL_STMT *stmt = nullptr;
+    if (rows.size() == 1)
+    {
+        rows[0]->err = stmts->Execute(STMT_INSERT_USER, params.data(), &stmt);
+        return;
+    }
+    unsigned int err = stmts->ExecuteInsertUsers(rows.size(), params.data(), &stmt);
+    if (err == 0)
+    {
+        return;
+    }
+    // 语句失败整体回滚（如其中一行主键冲突）：在一个事务内逐行重试以得到每行的结果，仍只提交一次
+    LOG_DEBUG("Batch insert of %d rows failed(%u), retry row by row", (int)rows.size(), err);
+    {
+        std::lock_guard<std::mutex> locker(mtx_);
+        fallbacks_++;
+    }
+    if (mysql_autocommit(sql, false))
+    {
+        err = mysql_errno(sql);
+        for (Row *row : rows)
+        {
+            row->err = err;
+        }
+        return;
+    }
+    // 唯一键冲突只回滚该行语句；其他错误可能已让事务整体回滚，放弃整个事务
+    unsigned int txErr = 0;
+    size_t done = 0;
+    for (; done < rows.size() && !txErr; done++)
+    {
+        rows[done]->err = stmts->Execute(STMT_INSERT_USER, &params[done * 2], &stmt);
+        if (rows[done]->err && rows[done]->err != ER_DUP_ENTRY)
+        {
+            txErr = rows[done]->err;
+        }
+    }
+    if (!txErr && mysql_commit(sql))
+    {
+        txErr = mysql_errno(sql);
+    }
+    if (txErr)
+    {
+        mysql_rollback(sql);
+        for (size_t i = 0; i < rows.size(); i++)
+        {
+            if (i >= done || rows[i]->err == 0)
+            {
+                rows[i]->err = txErr;
+            }
+        }
+    }
+    mysql_autocommit(sql, true);
+}
@@ -0,0 +1,81 @@
+//
+// 注册插入的组提交：请求线程把行放入批次并等待，提交线程在批次满或超过等待期限时
+// 用一条预处理的多行 INSERT 写入（单条语句即一个事务），失败时在一个事务内逐行重试并把每行结果分别返回
+// 请求线程在提交前一直阻塞，maxBatch 超过并发调用 Insert 的线程数时按数量提交永远不会触发
+//
+#ifndef SQL_BATCH_H
+#define SQL_BATCH_H
+
+#include <mysql/mysql.h>
+#include <mutex>
+#include <condition_variable>
+#include <thread>
+#include <chrono>
+#include <string>
+#include <vector>
+#include <deque>
+#include "sql_connect_pool.h"
+#include "../timer/deadline.h"
+
+class SqlInsertBatcher
+{
+public:
+    struct Stats
+    {
+        unsigned long long batches;   // 已提交批次数
+        unsigned long long rows;      // 已处理行数
+        unsigned long long fallbacks; // 多行插入失败后逐行重试的批次数
+        size_t pending;               // 等待提交的行数
+    };
+
+    SqlInsertBatcher() = default;
+    ~SqlInsertBatcher();
+
+    void Init(SqlConnPool *connPool, size_t maxBatch = 64, int maxDelayMs = 2);
+    void Close();
+
+    static const unsigned int EXPIRED = ~0u; // 提交前已过截止时间，该行未写入
+
+    // 阻塞直到所在批次提交，成功返回 0，否则返回该行的 MySQL 错误码（如 ER_DUP_ENTRY）或 EXPIRED
+    // 调用方不应持有连接池连接，以免与提交线程争用
+    unsigned int Insert(const std::string &name, const std::string &pwd, const Deadline &deadline = Deadline());
+
+    Stats GetStats();
+
+    SqlInsertBatcher(const SqlInsertBatcher &) = delete;
+    SqlInsertBatcher &operator=(const SqlInsertBatcher &) = delete;
+
+private:
+    typedef std::chrono::steady_clock Clock;
+
+    struct Row
+    {
+        const std::string *name;
+        const std::string *pwd;
+        const Deadline *deadline;
+        Clock::time_point enqueued;
+        unsigned int err;
+        bool done;
+    };
+
+    void Run_();
+    void Flush_(std::vector<Row *> &batch);
+    void FlushRows_(MYSQL *sql, std::vector<Row *> &rows);
+
+    SqlConnPool *connPool_ = nullptr;
+    size_t maxBatch_ = 64;
+    Clock::duration maxDelay_{};
+
+    std::mutex mtx_;
+    std::condition_variable cond_;     // 唤醒提交线程
+    std::condition_variable doneCond_; // 唤醒等待结果的请求线程
+    std::deque<Row *> pending_;
+    bool isClose_ = true;
+    std::thread committer_;
+
+    unsigned long long batches_ = 0;
+    unsigned long long rows_ = 0;
+    unsigned long long fallbacks_ = 0;
+};
+
+#endif
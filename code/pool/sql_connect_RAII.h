@@ -14,6 +14,12 @@ public:
         connPool_ = connPool;
     }
 
+    // 接管调用方已获取的连接
+    SqlConnRAII(MYSQL *sql, SqlConnPool *connPool) : sql_(sql), connPool_(connPool)
+    {
+        assert(connPool);
+    }
+
     ~SqlConnRAII()
     {
         if (sql_)
@@ -1,4 +1,11 @@
 #include "sql_connect_pool.h"
+#include <vector>
+#include <ctime>
+#include <cerrno>
+
+const int SqlConnPool::DEFAULT_WAIT_MS;
+const int SqlConnPool::IDLE_CHECK_MS;
+const unsigned int SqlConnPool::CONNECT_TIMEOUT_S;
 
 SqlConnPool::~SqlConnPool()
 {
@@ -13,43 +20,205 @@ SqlConnPool *SqlConnPool::Instance()
 
 void SqlConnPool::Init(const char *host, int port,
                        const char *user, const char *pwd,
-                       const char *dbName, int connSize = 10)
+                       const char *dbName, int connSize,
+                       int maxConnSize, int maxLifetimeSec)
 {
-    assert(connSize > 0);
+    assert(connSize > 0 && maxLifetimeSec > 0);
+    host_ = host;
+    user_ = user;
+    pwd_ = pwd;
+    dbName_ = dbName;
+    port_ = port;
+    MIN_CONN_ = connSize;
+    MAX_CONN_ = std::max(connSize, maxConnSize);
+    maxLifetime_ = std::chrono::seconds(maxLifetimeSec);
+    sem_init(&semId, 0, 0);
+
+    // 并行建立初始连接，总耗时约等于单个连接的握手时间
+    std::vector<MYSQL *> conns(connSize, nullptr);
+    std::vector<std::thread> workers;
     for (int i = 0; i < connSize; i++)
     {
-        MYSQL *sql = nullptr;
-        sql = mysql_init(sql);
-        if (!sql)
-        {
-            LOG_ERROR("mysql init error!");
-            assert(sql);
-        }
-        sql = mysql_real_connect(sql, host, user, pwd, dbName, port, nullptr, 0);
-        if (!sql)
+        workers.emplace_back([this, &conns, i]
+                             { conns[i] = Connect_(); });
+    }
+    for (auto &t : workers)
+    {
+        t.join();
+    }
+
+    int ok = 0;
+    {
+        std::lock_guard<std::mutex> locker(mtx_);
+        for (MYSQL *sql : conns)
         {
-            LOG_ERROR("mysql connect error!");
+            if (!sql)
+            {
+                continue;
+            }
+            total_++;
+            AddConn_(sql);
+            connQue_.push(sql);
+            sem_post(&semId);
+            ok++;
         }
-        connQue_.push(sql);
     }
-    MAX_CONN_ = connSize;
-    sem_init(&semId, 0, MAX_CONN_); // 初始化信号量
+    if (ok < connSize)
+    {
+        LOG_ERROR("SqlConnPool only %d/%d connections ready!", ok, connSize);
+    }
 }
 
-MYSQL *SqlConnPool::GetConn()
+MYSQL *SqlConnPool::Connect_()
 {
-    MYSQL *sql = nullptr;
-    if (connQue_.empty())
+    MYSQL *sql = mysql_init(nullptr);
+    if (!sql)
     {
-        LOG_ERROR("SqlConnPool is busy!");
+        LOG_ERROR("mysql init error!");
         return nullptr;
     }
-    sem_wait(&semId); // 等待信号量
+    mysql_options(sql, MYSQL_OPT_CONNECT_TIMEOUT, &CONNECT_TIMEOUT_S);
+    if (!mysql_real_connect(sql, host_.c_str(), user_.c_str(), pwd_.c_str(), dbName_.c_str(), port_, nullptr, 0))
+    {
+        LOG_ERROR("mysql connect error: %s", mysql_error(sql));
+        mysql_close(sql);
+        return nullptr;
+    }
+    return sql;
+}
+
+void SqlConnPool::AddConn_(MYSQL *sql)
+{
+    ConnMeta &meta = meta_[sql];
+    meta.created = meta.lastUsed = Clock::now();
+    meta.stmts.reset(new SqlStmtCache(sql));
+    created_++;
+}
+
+void SqlConnPool::DropConn_(MYSQL *sql)
+{
+    meta_.erase(sql); // 语句须在连接关闭前释放
+    mysql_close(sql);
+    total_--;
+}
+
+MYSQL *SqlConnPool::TakeIdle_()
+{
+    MYSQL *sql = nullptr;
+    bool needPing = false;
     {
         std::lock_guard<std::mutex> locker(mtx_);
+        assert(!connQue_.empty());
         sql = connQue_.front();
         connQue_.pop();
+        needPing = Clock::now() - meta_[sql].lastUsed > std::chrono::milliseconds(IDLE_CHECK_MS);
     }
+    if (!needPing || mysql_ping(sql) == 0)
+    {
+        return sql;
+    }
+
+    // 连接已失效：丢弃并在后台重连，调用方继续在截止时间内等待，语句缓存随新连接重建
+    LOG_WARN("mysql ping failed: %s, reconnect", mysql_error(sql));
+    {
+        std::lock_guard<std::mutex> locker(mtx_);
+        DropConn_(sql);
+        reconnects_++;
+    }
+    Grow_();
+    return nullptr;
+}
+
+bool SqlConnPool::Grow_()
+{
+    {
+        std::lock_guard<std::mutex> locker(mtx_);
+        if (closed_ || total_ >= MAX_CONN_)
+        {
+            return false;
+        }
+        total_++; // 先占位，连接在后台线程建立
+        growing_++;
+    }
+    // 建连耗时不受调用方的等待时间约束，放到后台进行，建好后和归还的连接一样经信号量交给等待者
+    std::thread([this]
+                {
+        MYSQL *sql = Connect_();
+        std::lock_guard<std::mutex> locker(mtx_);
+        growing_--;
+        if (!sql || closed_)
+        {
+            if (sql)
+            {
+                mysql_close(sql);
+            }
+            total_--;
+        }
+        else
+        {
+            AddConn_(sql);
+            connQue_.push(sql);
+            sem_post(&semId);
+            LOG_INFO("SqlConnPool grow to %d", total_);
+        }
+        growCond_.notify_all(); })
+        .detach();
+    return true;
+}
+
+void SqlConnPool::RecordWait_(Clock::time_point start)
+{
+    long long waitUs = std::chrono::duration_cast<std::chrono::microseconds>(Clock::now() - start).count();
+    std::lock_guard<std::mutex> locker(mtx_);
+    avgWaitUs_ += (waitUs - avgWaitUs_) / 8;
+    maxWaitUs_ = std::max(maxWaitUs_, waitUs);
+}
+
+MYSQL *SqlConnPool::GetConn(int timeoutMs)
+{
+    Clock::time_point start = Clock::now();
+    struct timespec deadline;
+    clock_gettime(CLOCK_REALTIME, &deadline);
+    deadline.tv_sec += timeoutMs / 1000;
+    deadline.tv_nsec += (timeoutMs % 1000) * 1000000L;
+    if (deadline.tv_nsec >= 1000000000L)
+    {
+        deadline.tv_sec++;
+        deadline.tv_nsec -= 1000000000L;
+    }
+
+    MYSQL *sql = nullptr;
+    bool grown = false;
+    while (!sql)
+    {
+        if (sem_trywait(&semId) == 0)
+        {
+            sql = TakeIdle_();
+            continue;
+        }
+        // 无空闲连接：未达上限时在后台扩容（每次获取至多一次），然后在截止时间前等待新建或归还的连接
+        if (!grown)
+        {
+            grown = Grow_();
+        }
+        if (sem_timedwait(&semId, &deadline) == 0)
+        {
+            sql = TakeIdle_();
+        }
+        else if (errno == ETIMEDOUT)
+        {
+            {
+                std::lock_guard<std::mutex> locker(mtx_);
+                timeouts_++;
+            }
+            RecordWait_(start);
+            LOG_WARN("SqlConnPool is busy, wait %dms timeout!", timeoutMs);
+            return nullptr;
+        }
+    }
+    RecordWait_(start);
+    std::lock_guard<std::mutex> locker(mtx_);
+    acquires_++;
     return sql;
 }
 
@@ -57,18 +226,60 @@ void SqlConnPool::FreeConn(MYSQL *sql)
 {
     assert(sql);
     std::lock_guard<std::mutex> locker(mtx_);
+    ConnMeta &meta = meta_[sql];
+    meta.lastUsed = Clock::now();
+    if (meta.lastUsed - meta.created > maxLifetime_)
+    {
+        // 超过最大存活时间：关闭连接，需要时由 Grow_ 重新建立
+        DropConn_(sql);
+        recycled_++;
+        return;
+    }
     connQue_.push(sql);
     sem_post(&semId); // 释放信号量
 }
 
-void SqlConnPool::ClosePool()
+SqlStmtCache *SqlConnPool::GetStmtCache(MYSQL *sql)
 {
+    assert(sql);
     std::lock_guard<std::mutex> locker(mtx_);
+    auto it = meta_.find(sql);
+    return it == meta_.end() ? nullptr : it->second.stmts.get();
+}
+
+SqlConnPool::Stats SqlConnPool::GetStats()
+{
+    std::lock_guard<std::mutex> locker(mtx_);
+    Stats stats{};
+    stats.total = total_;
+    stats.idle = static_cast<int>(connQue_.size());
+    stats.minConn = MIN_CONN_;
+    stats.maxConn = MAX_CONN_;
+    stats.acquires = acquires_;
+    stats.timeouts = timeouts_;
+    stats.created = created_;
+    stats.reconnects = reconnects_;
+    stats.recycled = recycled_;
+    stats.avgWaitUs = avgWaitUs_;
+    stats.maxWaitUs = maxWaitUs_;
+    return stats;
+}
+
+void SqlConnPool::ClosePool()
+{
+    std::unique_lock<std::mutex> locker(mtx_);
+    if (closed_)
+    {
+        return;
+    }
+    closed_ = true;
+    growCond_.wait(locker, [this]
+                   { return growing_ == 0; });
     while (!connQue_.empty())
     {
         auto sql = connQue_.front();
         connQue_.pop();
-        mysql_close(sql);
+        DropConn_(sql);
     }
     mysql_library_end();
-}
\ No newline at end of file
+}
@@ -8,33 +8,91 @@
 #include <thread>
 #include <cassert>
 #include <iostream>
+#include <memory>
+#include <chrono>
+#include <string>
+#include <unordered_map>
+#include <condition_variable>
 #include "../log/log.h"
+#include "sql_stmt.h"
 
 class SqlConnPool
 {
 public:
+    struct Stats
+    {
+        int total;                  // 当前连接数（含正在建立的）
+        int idle;                   // 空闲连接数
+        int minConn, maxConn;
+        unsigned long long acquires;   // 成功获取次数
+        unsigned long long timeouts;   // 等待超时次数
+        unsigned long long created;    // 新建连接次数（含扩容与重连）
+        unsigned long long reconnects; // ping 失败后重连次数
+        unsigned long long recycled;   // 超过最大存活时间被回收的连接数
+        long long avgWaitUs;           // 获取连接等待时间的滑动平均
+        long long maxWaitUs;           // 获取连接的最长等待时间
+    };
+
     static SqlConnPool *Instance();
 
-    MYSQL *GetConn();
+    MYSQL *GetConn(int timeoutMs = DEFAULT_WAIT_MS); // 超时返回 nullptr
     void FreeConn(MYSQL *sql);
+    SqlStmtCache *GetStmtCache(MYSQL *sql); // 该连接的预处理语句缓存，只能由持有连接的线程使用
 
+    // 并行建立 connSize 个连接；争用时在后台扩容到 maxConnSize，连接存活超过 maxLifetimeSec 后归还时回收
     void Init(const char *host, int port,
               const char *user, const char *pwd,
-              const char *dbName, int connSize);
-    void ClosePool();
+              const char *dbName, int connSize,
+              int maxConnSize = 0, int maxLifetimeSec = 3600);
+    void ClosePool(); // 可重复调用，只有第一次生效
+
+    Stats GetStats();
 
     SqlConnPool(const SqlConnPool &) = delete;
     SqlConnPool &operator=(const SqlConnPool &) = delete;
 
+    static const int DEFAULT_WAIT_MS = 1000;
+    static const int IDLE_CHECK_MS = 30000; // 空闲超过该时间的连接取出时先 ping
+    static const unsigned int CONNECT_TIMEOUT_S = 3; // 建立连接的超时，限制后台扩容线程的阻塞时间
+
 private:
+    typedef std::chrono::steady_clock Clock;
+
+    struct ConnMeta
+    {
+        Clock::time_point created;
+        Clock::time_point lastUsed;
+        std::unique_ptr<SqlStmtCache> stmts;
+    };
+
     SqlConnPool() = default;
     ~SqlConnPool();
 
-    int MAX_CONN_;
+    MYSQL *Connect_();                // 阻塞建立新连接，失败返回 nullptr
+    void AddConn_(MYSQL *sql);        // 登记新连接的元数据，调用方需持有 mtx_
+    void DropConn_(MYSQL *sql);       // 关闭并注销连接，调用方需持有 mtx_
+    MYSQL *TakeIdle_();               // 取出一个空闲连接并做健康检查，失效时返回 nullptr 并在后台补建
+    bool Grow_();                     // 未达上限时在后台新建连接，建好后放入空闲队列
+    void RecordWait_(Clock::time_point start);
+
+    int MIN_CONN_ = 0;
+    int MAX_CONN_ = 0;
+    int total_ = 0;
+    std::chrono::seconds maxLifetime_{3600};
+
+    std::string host_, user_, pwd_, dbName_;
+    int port_ = 0;
 
     std::queue<MYSQL *> connQue_;
+    std::unordered_map<MYSQL *, ConnMeta> meta_;
     std::mutex mtx_;
     sem_t semId;
+    int growing_ = 0;                 // 正在后台建立的连接数
+    std::condition_variable growCond_; // ClosePool 等待后台建连结束
+    bool closed_ = false;
+
+    unsigned long long acquires_ = 0, timeouts_ = 0, created_ = 0, reconnects_ = 0, recycled_ = 0;
+    long long avgWaitUs_ = 0, maxWaitUs_ = 0;
 };
 
-#endif
\ No newline at end of file
+#endif
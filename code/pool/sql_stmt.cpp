@@ -0,0 +1,143 @@
+#include "sql_stmt.h"
+#include <mysql/errmsg.h>
+#include <mysql/mysqld_error.h>
+#include <cassert>
+#include <cstring>
+#include <string>
+
+const char *SqlStmtCache::STMT_SQL[STMT_NUM] = {
+    "SELECT password FROM user WHERE username=? LIMIT 1",
+    "INSERT INTO user(username,password) VALUES(?,?)",
+};
+
+SqlStmtCache::SqlStmtCache(MYSQL *sql) : sql_(sql)
+{
+    assert(sql_);
+    for (int i = 0; i < STMT_NUM; i++)
+    {
+        stmts_[i] = nullptr;
+    }
+}
+
+SqlStmtCache::~SqlStmtCache()
+{
+    Invalidate();
+}
+
+MYSQL_STMT *SqlStmtCache::Get(SQL_STMT_ID id)
+{
+    assert(id >= 0 && id < STMT_NUM);
+    if (stmts_[id])
+    {
+        return stmts_[id];
+    }
+    stmts_[id] = Prepare_(STMT_SQL[id], strlen(STMT_SQL[id]));
+    return stmts_[id];
+}
+
+MYSQL_STMT *SqlStmtCache::Prepare_(const char *query, size_t len)
+{
+    MYSQL_STMT *stmt = mysql_stmt_init(sql_);
+    if (!stmt)
+    {
+        LOG_ERROR("mysql_stmt_init error: %s", mysql_error(sql_));
+        return nullptr;
+    }
+    if (mysql_stmt_prepare(stmt, query, len))
+    {
+        LOG_ERROR("prepare stmt [%.64s] error: %s", query, mysql_stmt_error(stmt));
+        mysql_stmt_close(stmt);
+        return nullptr;
+    }
+    return stmt;
+}
+
+MYSQL_STMT *SqlStmtCache::GetInsertUsers_(size_t rows)
+{
+    assert(rows > 0);
+    if (rows >= insertUsers_.size())
+    {
+        insertUsers_.resize(rows + 1, nullptr);
+    }
+    if (!insertUsers_[rows])
+    {
+        std::string query = "INSERT INTO user(username,password) VALUES(?,?)";
+        for (size_t i = 1; i < rows; i++)
+        {
+            query += ",(?,?)";
+        }
+        insertUsers_[rows] = Prepare_(query.c_str(), query.size());
+    }
+    return insertUsers_[rows];
+}
+
+void SqlStmtCache::Invalidate()
+{
+    for (int i = 0; i < STMT_NUM; i++)
+    {
+        if (stmts_[i])
+        {
+            mysql_stmt_close(stmts_[i]);
+            stmts_[i] = nullptr;
+        }
+    }
+    for (MYSQL_STMT *&stmt : insertUsers_)
+    {
+        if (stmt)
+        {
+            mysql_stmt_close(stmt);
+            stmt = nullptr;
+        }
+    }
+}
+
+void SqlStmtCache::Reset(MYSQL *sql)
+{
+    assert(sql);
+    Invalidate();
+    sql_ = sql;
+}
+
+bool SqlStmtCache::IsStale_(unsigned int err)
+{
+    return err == CR_SERVER_GONE_ERROR || err == CR_SERVER_LOST || err == ER_UNKNOWN_STMT_HANDLER;
+}
+
+unsigned int SqlStmtCache::Execute(SQL_STMT_ID id, MYSQL_BIND *params, MYSQL_STMT **stmt)
+{
+    return Execute_([this, id]
+                    { return Get(id); }, params, stmt);
+}
+
+unsigned int SqlStmtCache::ExecuteInsertUsers(size_t rows, MYSQL_BIND *params, MYSQL_STMT **stmt)
+{
+    return Execute_([this, rows]
+                    { return GetInsertUsers_(rows); }, params, stmt);
+}
+
+unsigned int SqlStmtCache::Execute_(const std::function<MYSQL_STMT *()> &get, MYSQL_BIND *params, MYSQL_STMT **stmt)
+{
+    assert(stmt);
+    unsigned int err = CR_UNKNOWN_ERROR;
+    for (int attempt = 0; attempt < 2; attempt++)
+    {
+        *stmt = get();
+        if (!*stmt)
+        {
+            return err;
+        }
+        if (mysql_stmt_bind_param(*stmt, params) == 0 && mysql_stmt_execute(*stmt) == 0)
+        {
+            return 0;
+        }
+        err = mysql_stmt_errno(*stmt);
+        if (!IsStale_(err))
+        {
+            return err; // 语句本身执行失败（如唯一键冲突），由调用方处理
+        }
+        // 语句句柄已失效：丢弃后重新预处理
+        LOG_WARN("stmt is stale(%u), prepare again", err);
+        Invalidate();
+    }
+    return err;
+}
@@ -0,0 +1,53 @@
+//
+// 每个连接池连接上的预处理语句缓存：按语句编号懒加载，连接失效后自动重新预处理
+//
+#ifndef SQL_STMT_H
+#define SQL_STMT_H
+
+#include <mysql/mysql.h>
+#include <vector>
+#include <functional>
+#include "../log/log.h"
+
+enum SQL_STMT_ID
+{
+    STMT_QUERY_PASSWORD = 0, // SELECT password FROM user WHERE username=?
+    STMT_INSERT_USER,        // INSERT INTO user(username,password) VALUES(?,?)
+    STMT_NUM,
+};
+
+class SqlStmtCache
+{
+public:
+    explicit SqlStmtCache(MYSQL *sql);
+    ~SqlStmtCache();
+
+    MYSQL_STMT *Get(SQL_STMT_ID id); // 未预处理时先 prepare，失败返回 nullptr
+    void Invalidate();               // 关闭全部语句（重连后语句句柄失效）
+    void Reset(MYSQL *sql);          // 连接被替换时调用
+
+    // 绑定参数并执行，成功返回 0，否则返回 MySQL 错误码；执行后的语句句柄通过 stmt 返回
+    // 若因连接断开或服务端丢失语句句柄而失败，则重新预处理并重试一次
+    unsigned int Execute(SQL_STMT_ID id, MYSQL_BIND *params, MYSQL_STMT **stmt);
+
+    // 多行插入 INSERT INTO user(username,password) VALUES(?,?),...，params 依次为每行的用户名和密码
+    // 每种行数各预处理一次并缓存，失败重试规则同 Execute
+    unsigned int ExecuteInsertUsers(size_t rows, MYSQL_BIND *params, MYSQL_STMT **stmt);
+
+    SqlStmtCache(const SqlStmtCache &) = delete;
+    SqlStmtCache &operator=(const SqlStmtCache &) = delete;
+
+private:
+    static bool IsStale_(unsigned int err);
+    MYSQL_STMT *Prepare_(const char *query, size_t len);
+    MYSQL_STMT *GetInsertUsers_(size_t rows);
+    unsigned int Execute_(const std::function<MYSQL_STMT *()> &get, MYSQL_BIND *params, MYSQL_STMT **stmt);
+
+    MYSQL *sql_;
+    MYSQL_STMT *stmts_[STMT_NUM];
+    std::vector<MYSQL_STMT *> insertUsers_; // 下标为行数
+
+    static const char *STMT_SQL[STMT_NUM];
+};
+
+#endif
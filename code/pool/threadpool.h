@@ -7,33 +7,46 @@
 #include <queue>
 #include <functional>
 #include <memory>
+#include <chrono>
 #include <cassert>
 
 class ThreadPool
 {
 public:
-    explicit ThreadPool(size_t threadCount) : pool_(std::make_shared<Pool>())
+    typedef std::chrono::steady_clock Clock;
+
+    struct Stats
+    {
+        size_t queueLen;          // 排队中的任务数
+        size_t threadCount;       // 当前线程数
+        size_t busyThreads;       // 正在执行任务的线程数
+        long long queueDelayUs;   // 出队任务排队时延的滑动平均（微秒）
+        long long headDelayUs;    // 队首任务已等待的时间（微秒）
+        unsigned long long completed; // 已完成任务数
+        unsigned long long rejected;  // 队列满被拒绝的任务数
+        unsigned long long shed;      // CoDel 过载丢弃的任务数
+        bool overloaded;              // 是否处于 CoDel 丢弃状态
+    };
+
+    // 固定线程数
+    explicit ThreadPool(size_t threadCount) : ThreadPool(threadCount, threadCount) {}
+
+    // 弹性模式：排队时延超过 growDelayMs 时扩容，线程空闲超过 idleTimeoutMs 后回收（不低于 minThreads）
+    // maxQueue > 0 时 TryAddTask 在队列满时拒绝任务
+    ThreadPool(size_t minThreads, size_t maxThreads, int growDelayMs = 10, int idleTimeoutMs = 30000,
+               size_t maxQueue = 0)
+        : pool_(std::make_shared<Pool>())
     {
-        assert(threadCount>0);
-        for (size_t i = 0; i < threadCount; i++)
+        assert(minThreads > 0 && maxThreads >= minThreads);
+        pool_->maxQueue = maxQueue;
+        pool_->minThreads = minThreads;
+        pool_->maxThreads = maxThreads;
+        pool_->growDelay = std::chrono::milliseconds(growDelayMs);
+        pool_->idleTimeout = std::chrono::milliseconds(idleTimeoutMs);
+        std::lock_guard<std::mutex> locker(pool_->mtx);
+        for (size_t i = 0; i < minThreads; i++)
         {
-            std::thread([pool = pool_]
-                        {
-                std::unique_lock<std::mutex> locker(pool->mtx);
-                while(true){
-                    if(!pool->tasks.empty()){
-                        auto task=std::move(pool->tasks.front());
-                        pool->tasks.pop();
-                        locker.unlock();
-                        task();
-                        locker.lock();
-                    }else if(pool->isClose){
-                        break;
-                    }else{
-                        pool->cv.wait(locker);
-                    }
-                } })
-                .detach();
+            Spawn_(pool_);
         }
     }
 
@@ -58,21 +71,199 @@ public:
     {
         {
             std::lock_guard<std::mutex> locker(pool_->mtx);
-            pool_->tasks.emplace(std::forward<T>(task));
+            pool_->tasks.push({std::function<void()>(std::forward<T>(task)), Clock::now()});
+            TryGrow_(pool_);
         }
         pool_->cv.notify_one();
     }
 
+    // CoDel 准入控制：出队任务的排队时延在整个 intervalMs 内都高于 targetMs 时进入过载状态，
+    // 过载期间 TryAddTask 直接拒绝新任务，直到某个任务的排队时延回落到 targetMs 以下
+    void EnableCoDel(int targetMs, int intervalMs)
+    {
+        assert(targetMs > 0 && intervalMs > 0);
+        std::lock_guard<std::mutex> locker(pool_->mtx);
+        pool_->codelTarget = std::chrono::milliseconds(targetMs);
+        pool_->codelInterval = std::chrono::milliseconds(intervalMs);
+    }
+
+    // 有界入队，队列已满或过载时返回 false
+    template <class T>
+    bool TryAddTask(T &&task)
+    {
+        {
+            std::lock_guard<std::mutex> locker(pool_->mtx);
+            if (pool_->maxQueue > 0 && pool_->tasks.size() >= pool_->maxQueue)
+            {
+                pool_->rejected++;
+                return false;
+            }
+            if (pool_->dropping)
+            {
+                pool_->shed++;
+                return false;
+            }
+            pool_->tasks.push({std::function<void()>(std::forward<T>(task)), Clock::now()});
+            TryGrow_(pool_);
+        }
+        pool_->cv.notify_one();
+        return true;
+    }
+
+    Stats GetStats() const
+    {
+        std::lock_guard<std::mutex> locker(pool_->mtx);
+        Stats stats{};
+        stats.queueLen = pool_->tasks.size();
+        stats.threadCount = pool_->threadCount;
+        stats.busyThreads = pool_->busyThreads;
+        stats.queueDelayUs = pool_->avgDelayUs;
+        stats.headDelayUs = pool_->tasks.empty() ? 0 : ToUs_(Clock::now() - pool_->tasks.front().enqueued);
+        stats.completed = pool_->completed;
+        stats.rejected = pool_->rejected;
+        stats.shed = pool_->shed;
+        stats.overloaded = pool_->dropping;
+        return stats;
+    }
+
+    bool IsElastic() const { return pool_->maxThreads > pool_->minThreads; }
+
+    // 由外部定时调用：所有线程都阻塞在任务里且不再有任务入队时，入队和出队都不会触发扩容，
+    // 排队的任务只能靠这里补线程
+    void Maintain()
+    {
+        std::lock_guard<std::mutex> locker(pool_->mtx);
+        TryGrow_(pool_);
+    }
+
 private:
+    struct Task
+    {
+        std::function<void()> fn;
+        Clock::time_point enqueued; // 入队时间
+    };
+
     struct Pool
     {
         std::mutex mtx;
         std::condition_variable cv;
-        std::queue<std::function<void()>> tasks;
+        std::queue<Task> tasks;
         bool isClose = false;
+        size_t maxQueue = 0;
+
+        size_t minThreads = 0;
+        size_t maxThreads = 0;
+        size_t threadCount = 0;
+        size_t busyThreads = 0;
+        Clock::duration growDelay{};
+        Clock::duration idleTimeout{};
+
+        long long avgDelayUs = 0;
+        unsigned long long completed = 0;
+        unsigned long long rejected = 0;
+
+        Clock::duration codelTarget{};      // 为 0 表示未启用 CoDel
+        Clock::duration codelInterval{};
+        Clock::time_point firstAboveTime{}; // 排队时延持续高于 target 的截止判定时间
+        bool aboveTarget = false;
+        bool dropping = false;
+        unsigned long long shed = 0;
     };
 
+    static long long ToUs_(Clock::duration d)
+    {
+        return std::chrono::duration_cast<std::chrono::microseconds>(d).count();
+    }
+
+    // 调用方需持有 pool->mtx
+    static void Spawn_(const std::shared_ptr<Pool> &pool)
+    {
+        pool->threadCount++;
+        std::thread([pool]
+                    { Work_(pool); })
+            .detach();
+    }
+
+    // 队首任务等待超过阈值且所有线程都在忙时扩容一个线程，调用方需持有 pool->mtx
+    static void TryGrow_(const std::shared_ptr<Pool> &pool)
+    {
+        if (pool->threadCount >= pool->maxThreads || pool->tasks.empty() ||
+            pool->busyThreads < pool->threadCount)
+        {
+            return;
+        }
+        if (Clock::now() - pool->tasks.front().enqueued >= pool->growDelay)
+        {
+            Spawn_(pool);
+        }
+    }
+
+    // 按出队任务的排队时延更新 CoDel 状态，调用方需持有 pool->mtx
+    static void UpdateCoDel_(const std::shared_ptr<Pool> &pool, Clock::duration sojourn, Clock::time_point now)
+    {
+        if (pool->codelTarget == Clock::duration::zero())
+        {
+            return;
+        }
+        if (sojourn < pool->codelTarget || pool->tasks.empty())
+        {
+            pool->aboveTarget = false;
+            pool->dropping = false;
+        }
+        else if (!pool->aboveTarget)
+        {
+            pool->aboveTarget = true;
+            pool->firstAboveTime = now + pool->codelInterval;
+        }
+        else if (now >= pool->firstAboveTime)
+        {
+            pool->dropping = true;
+        }
+    }
+
+    static void Work_(std::shared_ptr<Pool> pool)
+    {
+        std::unique_lock<std::mutex> locker(pool->mtx);
+        while (true)
+        {
+            if (!pool->tasks.empty())
+            {
+                Task task = std::move(pool->tasks.front());
+                pool->tasks.pop();
+                Clock::time_point now = Clock::now();
+                UpdateCoDel_(pool, now - task.enqueued, now);
+                long long delayUs = ToUs_(now - task.enqueued);
+                pool->avgDelayUs += (delayUs - pool->avgDelayUs) / 8; // EWMA, alpha = 1/8
+                pool->busyThreads++;
+                TryGrow_(pool);
+                locker.unlock();
+                task.fn();
+                locker.lock();
+                pool->busyThreads--;
+                pool->completed++;
+            }
+            else if (pool->isClose)
+            {
+                break;
+            }
+            else if (pool->threadCount > pool->minThreads)
+            {
+                // 空闲冷却期结束仍无任务，回收多余线程
+                if (pool->cv.wait_for(locker, pool->idleTimeout) == std::cv_status::timeout &&
+                    pool->tasks.empty() && pool->threadCount > pool->minThreads)
+                {
+                    break;
+                }
+            }
+            else
+            {
+                pool->cv.wait(locker);
+            }
+        }
+        pool->threadCount--;
+    }
+
     std::shared_ptr<Pool> pool_;
 };
 
-#endif
\ No newline at end of file
+#endif
@@ -1,55 +1,347 @@
 #include "WebServer.h"
+#include <sys/eventfd.h>
+#include <netinet/tcp.h>
+#include <poll.h>
+#include <fstream>
+#include <sstream>
+
+const char WebServer::OVERLOAD_RESPONSE[] =
+    "HTTP/1.1 503 Service Unavailable\r\n"
+    "Connection: close\r\n"
+    "Retry-After: 1\r\n"
+    "Content-type: text/plain\r\n"
+    "Content-length: 20\r\n\r\n"
+    "Server overloaded.\r\n";
+
+const std::chrono::steady_clock::time_point WebServer::PROCESS_START = std::chrono::steady_clock::now();
 
 WebServer::WebServer(int port, int trigMode, int timeoutMs, bool OptLinger, size_t threadNum,
                      int sqlPort, const char *sqlUser, const char *sqlPwd, const char *dbName,
-                     int connPoolNum, bool openLog, int logLevel, int logDeqSize)
+                     int connPoolNum, bool openLog, int logLevel, int logDeqSize,
+                     const WebServerOptions &options)
     : port_(port), openLinger_(OptLinger), timeoutMs_(timeoutMs), isClose_(false),
-      epoll_(new Epoll()), threadpool_(new ThreadPool(threadNum)), timer_(new HeapTimer())
+      listenFd_(-1),
+      backlog_(options.backlog), acceptBudget_(options.acceptBudget),
+      idleFd_(-1),
+      epoll_(new Epoll()),
+      threadpool_(new ThreadPool(threadNum, std::max(threadNum, options.maxThreadNum))),
+      timer_(new HeapTimer()),
+      dbpool_(new ThreadPool(connPoolNum, std::max(connPoolNum, options.maxConnPoolNum), 10, 30000,
+                             DB_LANE_QUEUE_MAX)),
+      useSql_(options.userStorePath.empty()), requestBudgetMs_(options.requestBudgetMs),
+      asyncSqlReady_(false), firstByte_(false),
+      wakeupFd_(-1),
+      adminPort_(options.adminPort), adminFd_(-1),
+      adminStop_(false),
+      shedCount_(0),
+      acceptCount_(0), acceptReject_(0),
+      acceptDeferred_(0),
+      lastStats_(std::chrono::steady_clock::now()), lastPoolCheck_(lastStats_)
 {
+    threadpool_->EnableCoDel(CODEL_TARGET_MS, CODEL_INTERVAL_MS);
+    assert(backlog_ > 0 && acceptBudget_ > 0);
+    // 日志最先初始化，后台预热过程中的日志不会丢失
+    if (openLog)
+    {
+        Log::LOG_FORMAT format = static_cast<Log::LOG_FORMAT>(options.logFormat);
+        Log::Instance()->init(logLevel, "../../log", format == Log::LOG_FORMAT_BINARY ? ".blog" : ".log",
+                              logDeqSize, Log::LOG_BLOCK, format);
+        // 分模块级别，如 LOG_LEVELS=http=0,server=1，运行中也可调用 SetModuleLevel 调整
+        const char *levels = getenv("LOG_LEVELS");
+        if (levels && !Log::Instance()->SetLevels(levels))
+        {
+            LOG_WARN("Bad LOG_LEVELS: %s", levels);
+        }
+    }
+    if (options.openAccessLog)
+    {
+        // 按状态码类别抽样，如 ACCESS_LOG_SAMPLE=2xx=0.01,5xx=1
+        const char *sample = getenv("ACCESS_LOG_SAMPLE");
+        if (sample && !AccessLog::Instance()->SetSampleRates(sample))
+        {
+            LOG_WARN("Bad ACCESS_LOG_SAMPLE: %s", sample);
+        }
+        AccessLog::Instance()->Init("../../log");
+    }
+    // 阶段追踪：慢请求阈值可用 SLOW_REQUEST_MS 调整
+    const char *slowMs = getenv("SLOW_REQUEST_MS");
+    RequestTracer::Instance()->Enable(slowMs ? atoi(slowMs) : SLOW_REQUEST_MS);
+    // 用户存储：USER_STORE_PATH 指定嵌入式日志文件时不连接 MySQL，便于不依赖数据库的认证压测
+    std::string userStorePath = options.userStorePath;
+    const char *storePath = getenv("USER_STORE_PATH");
+    if (storePath && *storePath)
+    {
+        userStorePath = storePath;
+        useSql_ = false;
+    }
+    idleFd_ = open("/dev/null", O_RDONLY | O_CLOEXEC);
     srcDir_ = getcwd(nullptr, 256);
     assert(srcDir_);
     strncat(srcDir_, "/../../resources/", 20);
     HttpConn::userCount = 0;
+    HttpConn::isReady = false;
     HttpConn::srcDir = srcDir_;
-    SqlConnPool::Instance()->Init("localhost", sqlPort, sqlUser, sqlPwd, dbName, connPoolNum);
+    if (options.fileCacheSize > 0)
+    {
+        fileCache_.reset(new FileCache(options.fileCacheSize, FILE_CACHE_TTL_MS));
+        HttpResponse::fileCache = fileCache_.get();
+    }
 
+    // 先绑定监听，静态资源立即可用；用户存储与文件缓存在后台并行预热
     InitEventMode_(trigMode);
-    if (!InitSocket_())
+    if (!InitSocket_() || !InitWakeup_() || !InitAdmin_())
     {
         isClose_ = true;
     }
+    InitMetrics_();
 
-    if (openLog)
+    if (isClose_)
+    {
+        LOG_ERROR("========== Server init error!==========");
+        return;
+    }
+    LOG_INFO("========== Server init ==========");
+    LOG_INFO("Port:%d, OpenLinger: %s", port_, OptLinger ? "true" : "false");
+    LOG_INFO("Listen backlog: %d, accept budget: %d", backlog_, acceptBudget_);
+    LOG_INFO("Listen Mode: %s, OpenConn Mode: %s%s",
+             (listenEvent_ & EPOLLET ? "ET" : "LT"),
+             (connEvent_ & EPOLLET ? "ET" : "LT"),
+             (connInline_ ? " (in loop, no oneshot)" : ""));
+    LOG_INFO("LogSys level: %d", logLevel);
+    LOG_INFO("srcDir: %s", HttpConn::srcDir);
+    LOG_INFO("SqlConnPool num: %d~%d, ThreadPool num: %d~%d", connPoolNum,
+             std::max(connPoolNum, options.maxConnPoolNum), (int)threadNum,
+             (int)std::max(threadNum, options.maxThreadNum));
+    LOG_INFO("User store: %s", useSql_ ? dbName : userStorePath.c_str());
+    LOG_INFO("Request budget: %dms", requestBudgetMs_);
+    LOG_INFO("Listening after %lldms", (long long)SinceStartMs_());
+
+    WarmUpArgs args;
+    args.sqlPort = sqlPort;
+    args.sqlUser = sqlUser;
+    args.sqlPwd = sqlPwd;
+    args.dbName = dbName;
+    args.connPoolNum = connPoolNum;
+    args.maxConnPoolNum = options.maxConnPoolNum;
+    args.asyncSqlConnNum = options.asyncSqlConnNum;
+    args.userCacheSize = options.userCacheSize;
+    args.userCacheTtlMs = options.userCacheTtlMs;
+    args.openUserIndex = options.openUserIndex;
+    args.insertBatchSize = options.insertBatchSize;
+    args.userStorePath = userStorePath;
+    storeWarmer_ = std::thread(&WebServer::WarmUpStore_, this, args);
+    if (fileCache_)
+    {
+        fileWarmer_ = std::thread(&WebServer::WarmUpFiles_, this, options.fileCacheSize);
+    }
+}
+
+WebServer::~WebServer()
+{
+    isClose_ = true;
+    MetricsRegistry::Instance()->RemoveCallbacks(this);
+    adminStop_ = true;
+    if (adminThread_.joinable())
+    {
+        adminThread_.join();
+    }
+    if (adminFd_ >= 0)
+    {
+        close(adminFd_);
+    }
+    if (storeWarmer_.joinable())
+    {
+        storeWarmer_.join();
+    }
+    if (fileWarmer_.joinable())
+    {
+        fileWarmer_.join();
+    }
+    close(listenFd_);
+    if (wakeupFd_ >= 0)
+    {
+        close(wakeupFd_);
+    }
+    if (idleFd_ >= 0)
+    {
+        close(idleFd_);
+    }
+    HttpRequest::userCache = nullptr;
+    HttpRequest::userIndex = nullptr;
+    HttpRequest::userStore = nullptr;
+    HttpResponse::fileCache = nullptr;
+    if (insertBatcher_)
+    {
+        insertBatcher_->Close();
+    }
+    free(srcDir_);
+    if (useSql_ && HttpConn::isReady)
+    {
+        SqlConnPool::Instance()->ClosePool();
+    }
+}
+
+long long WebServer::SinceStartMs_()
+{
+    return std::chrono::duration_cast<std::chrono::milliseconds>(
+               std::chrono::steady_clock::now() - PROCESS_START).count();
+}
+
+// 后台线程：建立用户存储，完成后标记就绪；用户名索引在就绪之后继续加载
+void WebServer::WarmUpStore_(WarmUpArgs args)
+{
+    if (useSql_)
     {
-        Log::Instance()->init(logLevel, "../../log", ".log", logDeqSize);
-        if (isClose_)
+        // 缓存、索引与组提交都是为了减少 MySQL 往返，嵌入式存储不需要
+        SqlConnPool::Instance()->Init("localhost", args.sqlPort, args.sqlUser.c_str(), args.sqlPwd.c_str(),
+                                      args.dbName.c_str(), args.connPoolNum, args.maxConnPoolNum);
+        if (args.userCacheSize > 0)
         {
-            LOG_ERROR("========== Server init error!==========");
+            userCache_.reset(new HttpRequest::UserCache(args.userCacheSize, args.userCacheTtlMs));
+            HttpRequest::userCache = userCache_.get();
         }
-        else
+        // 批次上限不超过数据库通道的常驻线程数（见 SqlInsertBatcher）
+        int batchSize = std::min(args.insertBatchSize, args.connPoolNum);
+        if (batchSize < args.insertBatchSize)
+        {
+            LOG_INFO("Insert batch size %d capped to DB lane threads %d", args.insertBatchSize, batchSize);
+        }
+        if (batchSize > 1)
+        {
+            insertBatcher_.reset(new SqlInsertBatcher());
+            insertBatcher_->Init(SqlConnPool::Instance(), batchSize, INSERT_BATCH_DELAY_MS);
+        }
+        userStore_.reset(new MySqlUserStore(SqlConnPool::Instance(), insertBatcher_.get()));
+        if (args.openUserIndex)
         {
-            LOG_INFO("========== Server init ==========");
-            LOG_INFO("Port:%d, OpenLinger: %s", port_, OptLinger ? "true" : "false");
-            LOG_INFO("Listen Mode: %s, OpenConn Mode: %s",
-                     (listenEvent_ & EPOLLET ? "ET" : "LT"),
-                     (connEvent_ & EPOLLET ? "ET" : "LT"));
-            LOG_INFO("LogSys level: %d", logLevel);
-            LOG_INFO("srcDir: %s", HttpConn::srcDir);
-            LOG_INFO("SqlConnPool num: %d, ThreadPool num: %d", connPoolNum, threadNum);
+            // 索引只用于肯定判断，未加载完时也可以安全使用
+            userIndex_.reset(new UserIndex());
+            HttpRequest::userIndex = userIndex_.get();
         }
     }
+    else
+    {
+        LogUserStore *store = new LogUserStore();
+        userStore_.reset(store);
+        if (!store->Open(args.userStorePath))
+        {
+            LOG_ERROR("User store init error, stay not ready");
+            return;
+        }
+    }
+    HttpRequest::userStore = userStore_.get();
+    HttpConn::isReady = true;
+    LOG_INFO("Ready after %lldms (store: %s)", (long long)SinceStartMs_(), userStore_->Name());
+    NotifyReady_();
+
+    if (useSql_ && args.asyncSqlConnNum > 0)
+    {
+        InitAsyncSql_(args);
+    }
+    if (userIndex_)
+    {
+        InitUserIndex_();
+    }
 }
 
-WebServer::~WebServer()
+// 连接在后台建立，fd 交给事件循环线程注册，之后才允许登录走非阻塞客户端
+void WebServer::InitAsyncSql_(const WarmUpArgs &args)
 {
-    close(listenFd_);
-    isClose_ = true;
-    free(srcDir_);
-    SqlConnPool::Instance()->ClosePool();
+    std::shared_ptr<std::vector<int>> fds = std::make_shared<std::vector<int>>();
+    std::unique_ptr<AsyncSqlClient> client(new AsyncSqlClient());
+    if (!client->Init("localhost", args.sqlPort, args.sqlUser.c_str(), args.sqlPwd.c_str(), args.dbName.c_str(),
+                      args.asyncSqlConnNum, [fds](int fd)
+                      { fds->push_back(fd); return true; }))
+    {
+        return;
+    }
+    AsyncSqlClient *raw = client.release();
+    QueueInLoop_([this, raw, fds]
+                 {
+        asyncSql_.reset(raw);
+        for (int fd : *fds)
+        {
+            epoll_->AddFd(fd, EPOLLIN);
+        }
+        asyncSql_->SetModFd([this](int fd, uint32_t events)
+                            { return epoll_->ModFd(fd, events); });
+        asyncSql_->EnableReconnect([this](int fd)
+                                   { return epoll_->AddFd(fd, EPOLLIN); },
+                                   [this](std::function<void()> cb)
+                                   { QueueInLoop_(std::move(cb)); });
+        asyncSqlReady_ = true; });
+}
+
+// 后台线程：映射静态资源并预读进页缓存
+void WebServer::WarmUpFiles_(int maxFiles)
+{
+    std::vector<std::string> dirs{srcDir_};
+    int count = 0;
+    while (!dirs.empty() && count < maxFiles)
+    {
+        std::string dir = dirs.back();
+        dirs.pop_back();
+        DIR *dp = opendir(dir.c_str());
+        if (!dp)
+        {
+            continue;
+        }
+        while (struct dirent *entry = readdir(dp))
+        {
+            if (entry->d_name[0] == '.' || count >= maxFiles)
+            {
+                continue;
+            }
+            std::string path = dir + entry->d_name;
+            FileCache::FilePtr file = fileCache_->Get(path);
+            if (!file->err && S_ISDIR(file->st.st_mode))
+            {
+                dirs.push_back(path + "/");
+            }
+            else if (file->data)
+            {
+                madvise(file->data, file->st.st_size, MADV_WILLNEED);
+                count++;
+            }
+        }
+        closedir(dp);
+    }
+    LOG_INFO("File cache warmed: %d files after %lldms", count, (long long)SinceStartMs_());
+}
+
+// systemd 风格的就绪通知：向 NOTIFY_SOCKET 发送 READY=1
+void WebServer::NotifyReady_()
+{
+    const char *path = getenv("NOTIFY_SOCKET");
+    if (!path || (path[0] != '/' && path[0] != '@'))
+    {
+        return;
+    }
+    struct sockaddr_un addr{};
+    addr.sun_family = AF_UNIX;
+    size_t len = strnlen(path, sizeof(addr.sun_path) - 1);
+    memcpy(addr.sun_path, path, len);
+    if (path[0] == '@')
+    {
+        addr.sun_path[0] = '\0'; // 抽象命名空间
+    }
+    int fd = socket(AF_UNIX, SOCK_DGRAM | SOCK_CLOEXEC, 0);
+    if (fd < 0)
+    {
+        return;
+    }
+    const char msg[] = "READY=1";
+    if (sendto(fd, msg, sizeof(msg) - 1, 0, (struct sockaddr *)&addr,
+               offsetof(struct sockaddr_un, sun_path) + len) < 0)
+    {
+        LOG_WARN("sd_notify error: %s", strerror(errno));
+    }
+    close(fd);
 }
 
 void WebServer::InitEventMode_(int trigMode)
 {
+    connInline_ = false;
     listenEvent_ = EPOLLRDHUP;
     connEvent_ = EPOLLONESHOT | EPOLLRDHUP;
     switch (trigMode)
@@ -66,6 +358,12 @@ void WebServer::InitEventMode_(int trigMode)
         connEvent_ |= EPOLLET;
         listenEvent_ |= EPOLLET;
         break;
+    case 4:
+        // ET 且不使用 ONESHOT：连接只注册一次读写事件，由事件循环线程独占处理
+        connEvent_ = EPOLLRDHUP | EPOLLET | EPOLLIN | EPOLLOUT;
+        listenEvent_ |= EPOLLET;
+        connInline_ = true;
+        break;
     default:
         connEvent_ |= EPOLLET;
         listenEvent_ |= EPOLLET;
@@ -88,6 +386,15 @@ void WebServer::Start()
         {
             timeMs = timer_->GetNextTick();
         }
+        if (timeMs < 0 || timeMs > STATS_INTERVAL_MS)
+        {
+            timeMs = STATS_INTERVAL_MS;
+        }
+        if (timeMs > POOL_CHECK_MS && (threadpool_->IsElastic() || dbpool_->IsElastic()))
+        {
+            timeMs = POOL_CHECK_MS;
+        }
+        timerGauge_->Set(static_cast<int64_t>(timer_->Size()));
         int eventCnt = epoll_->Wait(timeMs);
         for (int i = 0; i < eventCnt; i++)
         {
@@ -97,26 +404,289 @@ void WebServer::Start()
             {
                 DealListen_();
             }
-            else if (events & (EPOLLRDHUP | EPOLLHUP | EPOLLERR))
+            else if (fd == wakeupFd_)
             {
-                assert(users_.count(fd) > 0);
-                CloseConn_(&users_[fd]);
+                DoPendingFunctors_();
             }
-            else if (events & EPOLLIN)
+            else if (asyncSql_ && asyncSql_->Owns(fd))
+            {
+                asyncSql_->OnEvent(fd);
+            }
+            else if (events & (EPOLLRDHUP | EPOLLHUP | EPOLLERR))
             {
                 assert(users_.count(fd) > 0);
-                DealRead_(&users_[fd]);
+                CloseConn_(&users_[fd]);
             }
-            else if (events & EPOLLOUT)
+            else if (events & (EPOLLIN | EPOLLOUT))
             {
                 assert(users_.count(fd) > 0);
-                DealWrite_(&users_[fd]);
+                HttpConn *client = &users_[fd];
+                if (events & EPOLLIN)
+                {
+                    DealRead_(client);
+                }
+                // ET 常驻模式下读写可能在同一个事件中到达，EPOLLOUT 边沿只通知一次，不能被读事件吞掉
+                if ((events & EPOLLOUT) && (connInline_ || !(events & EPOLLIN)) && !client->IsClosed())
+                {
+                    DealWrite_(client);
+                }
             }
             else
             {
                 LOG_ERROR("Unexpected event");
             }
         }
+        MaintainPools_();
+        LogStats_();
+    }
+}
+
+void WebServer::MaintainPools_()
+{
+    auto now = std::chrono::steady_clock::now();
+    if (std::chrono::duration_cast<std::chrono::milliseconds>(now - lastPoolCheck_).count() < POOL_CHECK_MS)
+    {
+        return;
+    }
+    lastPoolCheck_ = now;
+    threadpool_->Maintain();
+    dbpool_->Maintain();
+}
+
+void WebServer::LogStats_()
+{
+    auto now = std::chrono::steady_clock::now();
+    if (std::chrono::duration_cast<std::chrono::milliseconds>(now - lastStats_).count() < STATS_INTERVAL_MS)
+    {
+        return;
+    }
+    lastStats_ = now;
+    ThreadPool::Stats stats = threadpool_->GetStats();
+    LOG_INFO("ThreadPool threads:%d busy:%d queue:%d delay:%lldus head:%lldus done:%llu",
+             (int)stats.threadCount, (int)stats.busyThreads, (int)stats.queueLen,
+             stats.queueDelayUs, stats.headDelayUs, stats.completed);
+    LogAcceptStats_();
+    unsigned long long requests = HttpConn::requestCount;
+    LOG_INFO("epoll_ctl calls:%llu skipped:%llu requests:%llu per request:%.3f",
+             epoll_->CtlCount(), epoll_->CtlSkipped(), requests,
+             requests ? (double)epoll_->CtlCount() / requests : 0.0);
+    LOG_INFO("Load shedding overloaded:%s shed:%llu (pool:%llu)",
+             stats.overloaded ? "true" : "false", shedCount_, stats.shed);
+    stats = dbpool_->GetStats();
+    LOG_INFO("DB lane threads:%d busy:%d queue:%d delay:%lldus done:%llu rejected:%llu",
+             (int)stats.threadCount, (int)stats.busyThreads, (int)stats.queueLen,
+             stats.queueDelayUs, stats.completed, stats.rejected);
+    LOG_INFO("Lane latency fast: n=%llu p50=%lldus p99=%lldus p999=%lldus; db: n=%llu p50=%lldus p99=%lldus p999=%lldus",
+             (unsigned long long)fastLaneHist_->Count(), (long long)fastLaneHist_->Percentile(0.5),
+             (long long)fastLaneHist_->Percentile(0.99), (long long)fastLaneHist_->Percentile(0.999),
+             (unsigned long long)dbLaneHist_->Count(), (long long)dbLaneHist_->Percentile(0.5),
+             (long long)dbLaneHist_->Percentile(0.99), (long long)dbLaneHist_->Percentile(0.999));
+    LOG_INFO("Deadline expired worker:%llu dbQueue:%llu dbConn:%llu dbQuery:%llu response:%llu",
+             Deadline::ExpiredCount(Deadline::WORKER_QUEUE), Deadline::ExpiredCount(Deadline::DB_QUEUE),
+             Deadline::ExpiredCount(Deadline::DB_CONN), Deadline::ExpiredCount(Deadline::DB_QUERY),
+             Deadline::ExpiredCount(Deadline::RESPONSE));
+    if (fileCache_)
+    {
+        LOG_INFO("File cache hits:%llu misses:%llu fills:%llu coalesced:%llu", fileCache_->Hits(),
+                 fileCache_->Misses(), fileCache_->Fills(), fileCache_->Shared());
+    }
+    LOG_INFO("Credential lookups:%llu coalesced:%llu", HttpRequest::LookupExecs(), HttpRequest::LookupShared());
+    LOG_INFO("Log lines:%llu dropped:%llu writes:%llu syncs:%llu", Log::Instance()->Lines(),
+             Log::Instance()->Dropped(), Log::Instance()->FileWrites(), Log::Instance()->FileSyncs());
+    if (AccessLog::Instance()->IsOpen())
+    {
+        LOG_INFO("Access log records:%llu dropped:%llu", AccessLog::Instance()->Records(),
+                 AccessLog::Instance()->Dropped());
+    }
+    // 以下组件由后台预热线程创建，就绪后才能访问
+    if (!HttpConn::isReady)
+    {
+        LOG_INFO("User store not ready after %lldms", (long long)SinceStartMs_());
+        return;
+    }
+    if (useSql_)
+    {
+        SqlConnPool::Stats sqlStats = SqlConnPool::Instance()->GetStats();
+        LOG_INFO("SqlConnPool conns:%d/%d~%d idle:%d util:%.2f acquires:%llu timeouts:%llu wait avg:%lldus max:%lldus "
+                 "created:%llu reconnects:%llu recycled:%llu",
+                 sqlStats.total, sqlStats.minConn, sqlStats.maxConn, sqlStats.idle,
+                 sqlStats.total ? 1.0 - (double)sqlStats.idle / sqlStats.total : 0.0,
+                 sqlStats.acquires, sqlStats.timeouts, sqlStats.avgWaitUs, sqlStats.maxWaitUs,
+                 sqlStats.created, sqlStats.reconnects, sqlStats.recycled);
+    }
+    if (userCache_)
+    {
+        LOG_INFO("User cache size:%d hits:%llu misses:%llu", (int)userCache_->Size(),
+                 userCache_->Hits(), userCache_->Misses());
+    }
+    if (insertBatcher_)
+    {
+        SqlInsertBatcher::Stats batch = insertBatcher_->GetStats();
+        LOG_INFO("Insert batcher batches:%llu rows:%llu (%.1f/batch) fallbacks:%llu pending:%d",
+                 batch.batches, batch.rows, batch.batches ? (double)batch.rows / batch.batches : 0.0,
+                 batch.fallbacks, (int)batch.pending);
+    }
+    if (userIndex_)
+    {
+        UserIndex::Stats idx = userIndex_->GetStats();
+        LOG_INFO("User index users:%d mem:%dKB (%.1fMB/M users) queries:%llu taken:%llu fp:%llu/%llu (expected %.1e)",
+                 (int)idx.users, (int)(idx.memoryBytes >> 10), idx.mbPerMillion, idx.queries, idx.taken,
+                 idx.falsePositives, idx.absentChecks, idx.expectedFpRate);
+    }
+    if (asyncSql_)
+    {
+        LOG_INFO("Async SQL live conns:%d in flight:%d pending:%d", asyncSql_->LiveConns(), (int)asyncSql_->InFlight(),
+                 (int)asyncSql_->Pending());
+    }
+}
+
+void WebServer::InitMetrics_()
+{
+    MetricsRegistry *registry = MetricsRegistry::Instance();
+    fastLaneHist_ = registry->Histogram("webserver_request_duration_seconds",
+                                        "Time from dispatch to response ready.", "lane=\"fast\"");
+    dbLaneHist_ = registry->Histogram("webserver_request_duration_seconds",
+                                      "Time from dispatch to response ready.", "lane=\"db\"");
+    queueWaitHist_ = registry->Histogram("webserver_threadpool_wait_seconds", "Time requests wait in the worker queue.");
+    timerGauge_ = registry->Gauge("webserver_timers", "Connection timers in the heap.");
+    shedRequests_ = registry->Counter("webserver_http_requests_total", "HTTP responses by status code.", "code=\"503\"");
+
+    registry->GaugeFunc("webserver_connections_active", "Open client connections.", "",
+                        []
+                        { return static_cast<double>(HttpConn::userCount); }, this);
+    // 线程池状态在抓取时读取，每次读取取一次池锁
+    ThreadPool *pools[] = {threadpool_.get(), dbpool_.get()};
+    const char *labels[] = {"pool=\"worker\"", "pool=\"db\""};
+    for (int i = 0; i < 2; i++)
+    {
+        ThreadPool *pool = pools[i];
+        registry->GaugeFunc("webserver_threadpool_queue_length", "Tasks waiting in the thread pool queue.", labels[i],
+                            [pool]
+                            { return static_cast<double>(pool->GetStats().queueLen); }, this);
+        registry->GaugeFunc("webserver_threadpool_threads", "Thread pool size.", labels[i],
+                            [pool]
+                            { return static_cast<double>(pool->GetStats().threadCount); }, this);
+        registry->GaugeFunc("webserver_threadpool_busy_threads", "Threads running a task.", labels[i],
+                            [pool]
+                            { return static_cast<double>(pool->GetStats().busyThreads); }, this);
+        registry->GaugeFunc("webserver_threadpool_queue_delay_seconds", "Moving average of task queue delay.", labels[i],
+                            [pool]
+                            { return pool->GetStats().queueDelayUs / 1e6; }, this);
+        registry->CounterFunc("webserver_threadpool_rejected_total", "Tasks rejected by a full queue or load shedding.",
+                              labels[i],
+                              [pool]
+                              {
+                                  ThreadPool::Stats stats = pool->GetStats();
+                                  return static_cast<double>(stats.rejected + stats.shed); }, this);
+    }
+    if (useSql_)
+    {
+        registry->GaugeFunc("webserver_sql_pool_connections", "Open MySQL connections.", "",
+                            []
+                            { return static_cast<double>(SqlConnPool::Instance()->GetStats().total); }, this);
+        registry->GaugeFunc("webserver_sql_pool_utilization", "Share of MySQL connections in use.", "",
+                            []
+                            {
+                                SqlConnPool::Stats stats = SqlConnPool::Instance()->GetStats();
+                                return stats.total ? 1.0 - static_cast<double>(stats.idle) / stats.total : 0.0; }, this);
+        registry->CounterFunc("webserver_sql_pool_timeouts_total", "Connection acquires that timed out.", "",
+                              []
+                              { return static_cast<double>(SqlConnPool::Instance()->GetStats().timeouts); }, this);
+    }
+    registry->CounterFunc("webserver_log_lines_total", "Log lines written.", "",
+                          []
+                          { return static_cast<double>(Log::Instance()->Lines()); }, this);
+    registry->CounterFunc("webserver_log_dropped_total", "Log lines dropped because a buffer was full.", "",
+                          []
+                          { return static_cast<double>(Log::Instance()->Dropped()); }, this);
+    registry->CounterFunc("webserver_access_log_dropped_total", "Access log records dropped because a buffer was full.", "",
+                          []
+                          { return static_cast<double>(AccessLog::Instance()->Dropped()); }, this);
+}
+
+bool WebServer::InitAdmin_()
+{
+    if (adminPort_ <= 0)
+    {
+        return true;
+    }
+    HttpConn::exposeMetrics = false;
+    adminFd_ = socket(AF_INET, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (adminFd_ < 0)
+    {
+        LOG_ERROR("Create admin socket error!");
+        return false;
+    }
+    int optval = 1;
+    setsockopt(adminFd_, SOL_SOCKET, SO_REUSEADDR, &optval, sizeof(optval));
+    struct sockaddr_in addr{};
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_ANY);
+    addr.sin_port = htons(adminPort_);
+    if (bind(adminFd_, (struct sockaddr *)&addr, sizeof(addr)) < 0 || listen(adminFd_, 16) < 0)
+    {
+        LOG_ERROR("Admin port:%d error!", adminPort_);
+        return false;
+    }
+    adminThread_ = std::thread(&WebServer::AdminLoop_, this);
+    LOG_INFO("Admin port:%d", adminPort_);
+    return true;
+}
+
+// 管理端口请求很少，单线程阻塞处理，事件循环过载时仍能抓取指标
+void WebServer::AdminLoop_()
+{
+    while (!adminStop_)
+    {
+        struct pollfd pfd = {adminFd_, POLLIN, 0};
+        if (poll(&pfd, 1, ADMIN_POLL_MS) <= 0)
+        {
+            continue;
+        }
+        int fd = accept4(adminFd_, nullptr, nullptr, SOCK_CLOEXEC);
+        if (fd < 0)
+        {
+            continue;
+        }
+        struct timeval tv = {1, 0}; // 慢客户端不能卡住管理线程
+        setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv));
+        setsockopt(fd, SOL_SOCKET, SO_SNDTIMEO, &tv, sizeof(tv));
+        std::string request;
+        char buf[1024];
+        while (request.find("\r\n\r\n") == std::string::npos && request.size() < 8192)
+        {
+            ssize_t n = ::read(fd, buf, sizeof(buf));
+            if (n <= 0)
+            {
+                break;
+            }
+            request.append(buf, n);
+        }
+        std::string body;
+        std::string status;
+        if (request.compare(0, 13, "GET /metrics ") == 0)
+        {
+            status = "200 OK";
+            body = MetricsRegistry::Instance()->Render();
+        }
+        else
+        {
+            status = "404 Not Found";
+            body = "not found\n";
+        }
+        std::string response = "HTTP/1.1 " + status + "\r\nContent-type: text/plain; version=0.0.4\r\n"
+                               "Connection: close\r\nContent-length: " + std::to_string(body.size()) + "\r\n\r\n" + body;
+        size_t off = 0;
+        while (off < response.size())
+        {
+            ssize_t n = send(fd, response.data() + off, response.size() - off, MSG_NOSIGNAL);
+            if (n <= 0)
+            {
+                break;
+            }
+            off += n;
+        }
+        close(fd);
     }
 }
 
@@ -160,43 +730,138 @@ void WebServer::AddClient_(int fd, sockaddr_in addr)
                     { CloseConn_(capture0); });
     }
     epoll_->AddFd(fd, EPOLLIN | connEvent_);
-    SetFdNonblock(fd);
     LOG_INFO("Client[%d] in!", users_[fd].GetFd());
 }
 
 void WebServer::DealListen_()
 {
     struct sockaddr_in addr{};
-    socklen_t len = sizeof(addr);
-    do
+    for (int i = 0; i < acceptBudget_; i++)
     {
-        int fd = accept(listenFd_, (struct sockaddr *)&addr, &len);
+        socklen_t len = sizeof(addr);
+        int fd = accept4(listenFd_, (struct sockaddr *)&addr, &len, SOCK_NONBLOCK | SOCK_CLOEXEC);
         if (fd < 0)
         {
-            return;
+            if ((errno == EMFILE || errno == ENFILE) && RejectOnEmfile_())
+            {
+                continue;
+            }
+            if (errno == EINTR || errno == ECONNABORTED)
+            {
+                continue;
+            }
+            return; // EAGAIN：队列已空
         }
         else if (HttpConn::userCount >= MAX_FD)
         {
+            acceptReject_++;
             SendError_(fd, "Server busy!");
             LOG_WARN("Clients is full!");
-            return;
+            continue;
         }
+        acceptCount_++;
         AddClient_(fd, addr);
-    } while (listenEvent_ & EPOLLET);
+    }
+    // 预算用完但队列可能未空：LT 模式下次 epoll_wait 会再次就绪，ET 模式需主动推迟到下一轮
+    acceptDeferred_++;
+    if (listenEvent_ & EPOLLET)
+    {
+        QueueInLoop_([this]
+                     { DealListen_(); });
+    }
+}
+
+bool WebServer::RejectOnEmfile_()
+{
+    if (idleFd_ < 0)
+    {
+        LOG_ERROR("Out of fd and no reserve fd!");
+        return false;
+    }
+    close(idleFd_);
+    int fd = accept(listenFd_, nullptr, nullptr);
+    if (fd >= 0)
+    {
+        acceptReject_++;
+        send(fd, OVERLOAD_RESPONSE, sizeof(OVERLOAD_RESPONSE) - 1, MSG_DONTWAIT | MSG_NOSIGNAL);
+        close(fd);
+        LOG_WARN("Out of fd, reject a connection!");
+    }
+    idleFd_ = open("/dev/null", O_RDONLY | O_CLOEXEC);
+    return fd >= 0;
 }
 
 void WebServer::DealRead_(HttpConn *client)
 {
     assert(client);
     ExentTime_(client);
-    threadpool_->AddTask([this, client]
-                         { onRead_(client); });
+    auto start = std::chrono::steady_clock::now();
+    // 没有未完成的请求时，这次读事件带来的是新请求，从此刻开始计算截止时间
+    // 同一次读入的流水线请求共用这个截止时间
+    if (!client->IsVerifyPending() && client->ToWriteBytes() == 0)
+    {
+        client->SetDeadline(Deadline::After(start, requestBudgetMs_));
+        client->TraceDispatch(start);
+    }
+    if (connInline_)
+    {
+        onRead_(client);
+        fastLaneHist_->Record(std::chrono::duration_cast<std::chrono::microseconds>(
+            std::chrono::steady_clock::now() - start).count());
+        return;
+    }
+    bool queued = threadpool_->TryAddTask([this, client, start]
+                                          {
+        queueWaitHist_->Record(std::chrono::duration_cast<std::chrono::microseconds>(
+            std::chrono::steady_clock::now() - start).count());
+        client->TraceMark(RequestTrace::DEQUEUE);
+        if (client->GetDeadline().Expired())
+        {
+            ExpireConn_(client);
+            return;
+        }
+        onRead_(client);
+        fastLaneHist_->Record(std::chrono::duration_cast<std::chrono::microseconds>(
+            std::chrono::steady_clock::now() - start).count()); });
+    if (!queued)
+    {
+        ShedConn_(client);
+    }
+}
+
+void WebServer::ShedConn_(HttpConn *client)
+{
+    assert(client);
+    shedCount_++;
+    shedRequests_->Add();
+    send(client->GetFd(), OVERLOAD_RESPONSE, sizeof(OVERLOAD_RESPONSE) - 1, MSG_DONTWAIT | MSG_NOSIGNAL);
+    LOG_WARN("Server overloaded, shed client[%d]", client->GetFd());
+    CloseConn_(client);
+}
+
+void WebServer::ExpireConn_(HttpConn *client)
+{
+    assert(client);
+    Deadline::CountExpired(Deadline::WORKER_QUEUE);
+    shedRequests_->Add();
+    send(client->GetFd(), OVERLOAD_RESPONSE, sizeof(OVERLOAD_RESPONSE) - 1, MSG_DONTWAIT | MSG_NOSIGNAL);
+    LOG_DEBUG("Request deadline expired in queue, close client[%d]", client->GetFd());
+    CloseConn_(client);
 }
 
 void WebServer::DealWrite_(HttpConn *client)
 {
     assert(client);
     ExentTime_(client);
+    if (connInline_)
+    {
+        // 读写事件常驻，只有确实有待发送数据时才处理 EPOLLOUT
+        if (client->ToWriteBytes() > 0)
+        {
+            onWrite_(client);
+        }
+        return;
+    }
     threadpool_->AddTask([this, client]
                          { onWrite_(client); });
 }
@@ -212,6 +877,10 @@ void WebServer::onRead_(HttpConn *client)
         CloseConn_(client);
         return;
     }
+    if (client->IsVerifyPending() || client->ToWriteBytes() > 0)
+    {
+        return; // 上一个响应尚未完成，新数据留在读缓冲区中，写完后再处理
+    }
     onProcess_(client);
 }
 
@@ -219,7 +888,13 @@ void WebServer::onProcess_(HttpConn *client)
 {
     if (client->process())
     {
-        epoll_->ModFd(client->GetFd(), connEvent_ | EPOLLOUT);
+        if (client->IsVerifyPending())
+        {
+            DealVerify_(client);
+            return;
+        }
+        // 当前线程独占该连接，直接尝试写出，写缓冲区满时再注册 EPOLLOUT
+        onWrite_(client);
     }
     else
     {
@@ -227,12 +902,219 @@ void WebServer::onProcess_(HttpConn *client)
     }
 }
 
+// 阻塞的数据库校验放到独立的有界线程池，完成后投递回事件循环生成响应
+void WebServer::DealVerify_(HttpConn *client)
+{
+    assert(client);
+    const HttpRequest &request = client->GetRequest();
+    std::string name = request.GetPost("username");
+    std::string pwd = request.GetPost("password");
+    bool isLogin = request.IsLoginVerify();
+    uint64_t connId = client->GetConnId();
+    Deadline deadline = client->GetDeadline();
+    auto start = std::chrono::steady_clock::now();
+
+    // 用户存储仍在后台初始化
+    if (!HttpConn::isReady)
+    {
+        client->RejectVerify();
+        onWrite_(client);
+        return;
+    }
+
+    // 非阻塞客户端没有可用连接（重连中）时仍走数据库通道
+    if (asyncSqlReady_ && isLogin && asyncSql_->LiveConns() > 0)
+    {
+        QueueInLoop_([this, client, connId, name, pwd, deadline, start]
+                     { AsyncLogin_(client, connId, name, pwd, deadline, start); });
+        return;
+    }
+    DbLaneVerify_(client, connId, name, pwd, isLogin, deadline, start);
+}
+
+void WebServer::DbLaneVerify_(HttpConn *client, uint64_t connId, const std::string &name, const std::string &pwd,
+                              bool isLogin, Deadline deadline, std::chrono::steady_clock::time_point start)
+{
+    bool queued = dbpool_->TryAddTask([this, client, connId, name, pwd, isLogin, deadline, start]
+                                      {
+        int result = HttpRequest::VERIFY_EXPIRED;
+        if (deadline.Expired())
+        {
+            Deadline::CountExpired(Deadline::DB_QUEUE);
+        }
+        else
+        {
+            result = HttpRequest::UserVerify(name, pwd, isLogin, deadline);
+        }
+        QueueInLoop_([this, client, connId, result, start]
+                     { OnVerifyDone_(client, connId, result, start); }); });
+    if (!queued && !client->IsClosed() && client->GetConnId() == connId)
+    {
+        LOG_WARN("DB lane is full, reject client[%d]", client->GetFd());
+        client->RejectVerify();
+        onWrite_(client);
+    }
+}
+
+void WebServer::AsyncLogin_(HttpConn *client, uint64_t connId, const std::string &name, const std::string &pwd,
+                            Deadline deadline, std::chrono::steady_clock::time_point start)
+{
+    if (name.empty() || pwd.empty())
+    {
+        OnVerifyDone_(client, connId, HttpRequest::VERIFY_FAIL, start);
+        return;
+    }
+    if (deadline.Expired())
+    {
+        Deadline::CountExpired(Deadline::DB_QUEUE);
+        OnVerifyDone_(client, connId, HttpRequest::VERIFY_EXPIRED, start);
+        return;
+    }
+    std::string stored;
+    if (userCache_ && userCache_->Get(name, &stored))
+    {
+        OnVerifyDone_(client, connId, pwd == stored ? HttpRequest::VERIFY_OK : HttpRequest::VERIFY_FAIL, start);
+        return;
+    }
+    // 投递到事件循环期间连接可能已全部断开
+    if (asyncSql_->LiveConns() == 0)
+    {
+        DbLaneVerify_(client, connId, name, pwd, true, deadline, start);
+        return;
+    }
+    std::string query = "SELECT password FROM user WHERE username='" + asyncSql_->Escape(name) + "' LIMIT 1";
+    bool queued = asyncSql_->Query(query, [this, client, connId, name, pwd, deadline, start](MYSQL_RES *res)
+                                   {
+        // 已过期就不再改走数据库通道重试；排队期间过期的查询未发出，已由客户端计入 DB_QUEUE
+        if (!res && deadline.Expired())
+        {
+            OnVerifyDone_(client, connId, HttpRequest::VERIFY_EXPIRED, start);
+            return;
+        }
+        // 查询失败（连接断开或出错）不代表密码错误，改走数据库通道重试一次
+        if (!res)
+        {
+            LOG_DEBUG("Async login query failed, retry on DB lane");
+            DbLaneVerify_(client, connId, name, pwd, true, deadline, start);
+            return;
+        }
+        MYSQL_ROW row = mysql_fetch_row(res);
+        bool ok = row && row[0] && pwd == row[0];
+        if (row && row[0] && userCache_)
+        {
+            userCache_->Put(name, row[0]);
+        }
+        OnVerifyDone_(client, connId, ok ? HttpRequest::VERIFY_OK : HttpRequest::VERIFY_FAIL, start); }, deadline);
+    if (!queued && asyncSql_->LiveConns() == 0)
+    {
+        DbLaneVerify_(client, connId, name, pwd, true, deadline, start);
+    }
+    else if (!queued && !client->IsClosed() && client->GetConnId() == connId)
+    {
+        LOG_WARN("Async SQL queue is full, reject client[%d]", client->GetFd());
+        client->RejectVerify();
+        onWrite_(client);
+    }
+}
+
+void WebServer::OnVerifyDone_(HttpConn *client, uint64_t connId, int result,
+                              std::chrono::steady_clock::time_point start)
+{
+    dbLaneHist_->Record(std::chrono::duration_cast<std::chrono::microseconds>(
+        std::chrono::steady_clock::now() - start).count());
+    if (client->IsClosed() || client->GetConnId() != connId)
+    {
+        return; // 等待期间连接已关闭或 fd 已被复用
+    }
+    if (result == HttpRequest::VERIFY_EXPIRED)
+    {
+        client->RejectVerify(); // 已放弃校验，返回 503
+        onWrite_(client);
+        return;
+    }
+    if (client->GetDeadline().Expired())
+    {
+        Deadline::CountExpired(Deadline::RESPONSE); // 结果已经算出，仍然发送
+    }
+    client->FinishVerify(result == HttpRequest::VERIFY_OK);
+    onWrite_(client);
+}
+
+bool WebServer::InitWakeup_()
+{
+    wakeupFd_ = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if (wakeupFd_ < 0 || !epoll_->AddFd(wakeupFd_, EPOLLIN))
+    {
+        LOG_ERROR("Init wakeup fd error!");
+        return false;
+    }
+    return true;
+}
+
+// 索引在就绪前已发布，这里边加载边使用；加载失败时保留已载入的部分
+void WebServer::InitUserIndex_()
+{
+    UserIndex *index = userIndex_.get();
+    if (!userStore_->ForEachUser([index](const std::string &name)
+                                 { index->Add(name); }))
+    {
+        LOG_WARN("User index load failed, keep %d users loaded", (int)index->GetStats().users);
+        return;
+    }
+
+    UserIndex::Stats idx = userIndex_->GetStats();
+    LOG_INFO("User index loaded: %d users, %dKB (%.1fMB/M users), expected fp %.1e",
+             (int)idx.users, (int)(idx.memoryBytes >> 10), idx.mbPerMillion, idx.expectedFpRate);
+}
+
+void WebServer::QueueInLoop_(std::function<void()> cb)
+{
+    {
+        std::lock_guard<std::mutex> locker(pendingMtx_);
+        pendingFunctors_.push_back(std::move(cb));
+    }
+    uint64_t one = 1;
+    ssize_t n = ::write(wakeupFd_, &one, sizeof(one));
+    if (n != sizeof(one))
+    {
+        LOG_ERROR("Wakeup loop error!");
+    }
+}
+
+void WebServer::DoPendingFunctors_()
+{
+    uint64_t cnt = 0;
+    ssize_t n = ::read(wakeupFd_, &cnt, sizeof(cnt));
+    (void)n;
+    std::vector<std::function<void()>> functors;
+    {
+        std::lock_guard<std::mutex> locker(pendingMtx_);
+        functors.swap(pendingFunctors_);
+    }
+    for (auto &cb : functors)
+    {
+        cb();
+    }
+}
+
 void WebServer::onWrite_(HttpConn *client)
 {
     assert(client);
     int ret = -1;
     int writeErrno = 0;
     ret = client->write(&writeErrno);
+    if (ret > 0 && !firstByte_.exchange(true))
+    {
+        long long ms = SinceStartMs_();
+        if (ms > STARTUP_TARGET_MS)
+        {
+            LOG_WARN("First byte served after %lldms, target %dms", ms, STARTUP_TARGET_MS);
+        }
+        else
+        {
+            LOG_INFO("First byte served after %lldms, target %dms", ms, STARTUP_TARGET_MS);
+        }
+    }
     if (client->ToWriteBytes() == 0)
     {                              // 传输完成
         if (client->IsKeepAlive()) // 是否保持连接
@@ -252,6 +1134,46 @@ void WebServer::onWrite_(HttpConn *client)
     CloseConn_(client);
 }
 
+// 监听队列状态来自 TCP_INFO，溢出计数来自 /proc/net/netstat（系统全局）
+void WebServer::LogAcceptStats_()
+{
+    struct tcp_info info{};
+    socklen_t len = sizeof(info);
+    unsigned int queued = 0, maxQueued = 0;
+    if (getsockopt(listenFd_, IPPROTO_TCP, TCP_INFO, &info, &len) == 0)
+    {
+        queued = info.tcpi_unacked; // 监听 socket 上为当前 accept 队列长度
+        maxQueued = info.tcpi_sacked; // 监听 socket 上为 backlog 上限
+    }
+
+    long long overflows = -1, drops = -1;
+    std::ifstream netstat("/proc/net/netstat");
+    std::string names, values;
+    while (std::getline(netstat, names) && std::getline(netstat, values))
+    {
+        if (names.compare(0, 7, "TcpExt:") != 0)
+        {
+            continue;
+        }
+        std::istringstream nameStream(names), valueStream(values);
+        std::string name, value;
+        while (nameStream >> name && valueStream >> value)
+        {
+            if (name == "ListenOverflows")
+            {
+                overflows = std::stoll(value);
+            }
+            else if (name == "ListenDrops")
+            {
+                drops = std::stoll(value);
+            }
+        }
+        break;
+    }
+    LOG_INFO("Accept accepted:%llu rejected:%llu deferred:%llu queue:%u/%u ListenOverflows:%lld ListenDrops:%lld",
+             acceptCount_, acceptReject_, acceptDeferred_, queued, maxQueued, overflows, drops);
+}
+
 bool WebServer::InitSocket_()
 {
     int ret;
@@ -305,7 +1227,7 @@ bool WebServer::InitSocket_()
         return false;
     }
 
-    ret = listen(listenFd_, 6);
+    ret = listen(listenFd_, backlog_);
     if (ret < 0)
     {
         LOG_ERROR("Listen port:%d error!", port_);
@@ -327,5 +1249,5 @@ bool WebServer::InitSocket_()
 int WebServer::SetFdNonblock(int fd)
 {
     assert(fd > 0);
-    return fcntl(fd, F_SETFL, fcntl(fd, F_GETFD, 0) | O_NONBLOCK);
+    return fcntl(fd, F_SETFL, fcntl(fd, F_GETFL, 0) | O_NONBLOCK);
 }
\ No newline at end of file
@@ -8,20 +8,57 @@
 #include <cassert>
 #include <cstring>
 #include <fcntl.h>
+#include <chrono>
+#include <algorithm>
+#include <vector>
+#include <string>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <atomic>
+#include <dirent.h>
+#include <sys/mman.h>
+#include <sys/un.h>
+#include <cstddef>
 
 #include "epoll.h"
 #include "../http/http_connect.h"
 #include "../pool/threadpool.h"
 #include "../timer/heap_timer.h"
 #include "../pool/sql_connect_pool.h"
+#include "../pool/sql_async.h"
+#include "../store/mysql_user_store.h"
+#include "../store/log_user_store.h"
 #include "../log/log.h"
+#include "../metrics/metrics.h"
+
+// 基本参数之外的可调项，未设置的保持默认值
+struct WebServerOptions
+{
+    size_t maxThreadNum = 0;     // 工作线程池弹性上限，不大于 threadNum 时固定大小
+    int backlog = 1024;          // listen 队列长度
+    int acceptBudget = 64;       // 每次唤醒最多 accept 的连接数
+    int asyncSqlConnNum = 0;     // 非阻塞 MySQL 连接数，0 表示登录也走数据库通道
+    int maxConnPoolNum = 0;      // 连接池与数据库通道的弹性上限
+    int userCacheSize = 100000;  // 登录凭据缓存条目数，0 表示关闭
+    int userCacheTtlMs = 300000;
+    bool openUserIndex = true;   // 用户名存在性索引
+    int insertBatchSize = 64;    // 注册插入组提交的批大小，不超过 connPoolNum
+    std::string userStorePath;   // 嵌入式用户存储文件，为空表示使用 MySQL；可被 USER_STORE_PATH 覆盖
+    int requestBudgetMs = 3000;  // 请求处理预算，<= 0 表示不限时
+    int fileCacheSize = 1024;    // 静态文件映射缓存条目数，0 表示关闭
+    int logFormat = 0;           // 取值见 Log::LOG_FORMAT
+    bool openAccessLog = true;
+    int adminPort = 0;           // > 0 时 /metrics 只在该端口提供
+};
 
 class WebServer
 {
 public:
     WebServer(int port, int trigMode, int timeoutMs, bool OptLinger, size_t threadNum,
               int sqlPort, const char *sqlUser, const char *sqlPwd, const char *dbName,
-              int connPoolNum, bool openLog, int logLevel, int logDeqSize);
+              int connPoolNum, bool openLog, int logLevel, int logDeqSize,
+              const WebServerOptions &options = WebServerOptions());
     ~WebServer();
     void Start();
 
@@ -31,18 +68,68 @@ private:
     void AddClient_(int fd, sockaddr_in addr);
 
     void DealListen_();
+    bool RejectOnEmfile_(); // fd 耗尽时借用预留 fd 接受并关闭连接，避免监听 fd 空转
+    void LogAcceptStats_();
     void DealWrite_(HttpConn *client);
     void DealRead_(HttpConn *client);
 
     void SendError_(int fd, const char *info);
+    void ShedConn_(HttpConn *client); // 过载时返回预先生成的 503 并关闭连接
     void ExentTime_(HttpConn *client);
     void CloseConn_(HttpConn *client);
 
     void onRead_(HttpConn *client);
     void onWrite_(HttpConn *client);
     void onProcess_(HttpConn *client);
+    void DealVerify_(HttpConn *client); // 登录/注册分派到数据库通道
+    void DbLaneVerify_(HttpConn *client, uint64_t connId, const std::string &name, const std::string &pwd,
+                       bool isLogin, Deadline deadline, std::chrono::steady_clock::time_point start);
+    void AsyncLogin_(HttpConn *client, uint64_t connId, const std::string &name, const std::string &pwd,
+                     Deadline deadline, std::chrono::steady_clock::time_point start); // 非阻塞 MySQL 登录校验，在事件循环中执行
+    void OnVerifyDone_(HttpConn *client, uint64_t connId, int result,
+                       std::chrono::steady_clock::time_point start); // 在事件循环中完成校验
+    void ExpireConn_(HttpConn *client);                               // 排队超过截止时间，返回 503 并关闭
+
+    struct WarmUpArgs
+    {
+        int sqlPort;
+        std::string sqlUser, sqlPwd, dbName;
+        int connPoolNum, maxConnPoolNum, asyncSqlConnNum;
+        int userCacheSize, userCacheTtlMs;
+        bool openUserIndex;
+        int insertBatchSize;
+        std::string userStorePath; // 为空表示使用 MySQL
+    };
+
+    bool InitWakeup_();
+    void WarmUpStore_(WarmUpArgs args);           // 后台建立用户存储，完成后标记就绪
+    void InitAsyncSql_(const WarmUpArgs &args);   // 后台连接非阻塞客户端，交给事件循环启用
+    void WarmUpFiles_(int maxFiles);              // 后台预热静态文件缓存
+    void InitUserIndex_();                        // 从用户存储加载用户名索引
+    static void NotifyReady_();                   // sd_notify 风格的就绪通知
+    static long long SinceStartMs_();             // 距进程启动的毫秒数
+    void QueueInLoop_(std::function<void()> cb); // 其他线程把回调投递回事件循环
+    void DoPendingFunctors_();
+
+    void LogStats_(); // 周期性输出运行状态
+    void MaintainPools_(); // 周期性检查弹性线程池是否需要扩容
+    void InitMetrics_(); // 注册抓取时读取的指标
+    bool InitAdmin_();   // 监听管理端口
+    void AdminLoop_();   // 管理端口：逐个处理 GET /metrics，不经过事件循环
 
     static const int MAX_FD = 65536;
+    static const int STATS_INTERVAL_MS = 60000;
+    static const int POOL_CHECK_MS = 20;       // 弹性线程池的扩容检查间隔
+    static const int DB_LANE_QUEUE_MAX = 1024; // 数据库通道排队上限
+    static const int CODEL_TARGET_MS = 10;     // 任务排队时延目标
+    static const int CODEL_INTERVAL_MS = 100;  // 持续超过目标多久判定为过载
+    static const int INSERT_BATCH_DELAY_MS = 2; // 注册插入凑批的最长等待
+    static const int FILE_CACHE_TTL_MS = 1000;  // 文件缓存条目多久后重新 stat
+    static const int STARTUP_TARGET_MS = 100;   // 启动到发出第一个字节的目标
+    static const int ADMIN_POLL_MS = 200;       // 管理线程检查退出的间隔
+    static const int SLOW_REQUEST_MS = 500;     // 超过该耗时的请求输出各阶段耗时样例
+    static const std::chrono::steady_clock::time_point PROCESS_START;
+    static const char OVERLOAD_RESPONSE[];     // 预先生成的 503 响应
 
     static int SetFdNonblock(int fd);
 
@@ -51,15 +138,57 @@ private:
     int timeoutMs_;
     bool isClose_;
     int listenFd_;
+    int backlog_;      // listen 队列长度
+    int acceptBudget_; // 每次唤醒最多 accept 的连接数
+    int idleFd_;       // 预留 fd，EMFILE 时释放出来用于拒绝连接
     char *srcDir_;
 
     uint32_t listenEvent_;
     uint32_t connEvent_;
+    bool connInline_; // 连接在事件循环线程内处理（trigMode 4）
 
     std::unordered_map<int, HttpConn> users_;
     std::unique_ptr<Epoll> epoll_;
     std::unique_ptr<ThreadPool> threadpool_; // 添加线程池
     std::unique_ptr<HeapTimer> timer_;       // 添加定时器
+    std::unique_ptr<ThreadPool> dbpool_;     // 数据库通道：阻塞的登录/注册校验
+    std::unique_ptr<AsyncSqlClient> asyncSql_; // 非阻塞 MySQL 客户端，为空表示登录也走数据库通道
+    std::unique_ptr<HttpRequest::UserCache> userCache_; // 登录凭据缓存
+    std::unique_ptr<UserIndex> userIndex_;               // 用户名存在性索引
+    std::unique_ptr<SqlInsertBatcher> insertBatcher_;    // 注册插入组提交
+    std::unique_ptr<UserStore> userStore_;               // 用户存储后端
+    std::unique_ptr<FileCache> fileCache_;               // 静态文件映射缓存
+    bool useSql_;                                        // 是否使用 MySQL 后端
+    int requestBudgetMs_;                                // 请求处理预算，<= 0 表示不限时
+
+    std::thread storeWarmer_;
+    std::thread fileWarmer_;
+    std::atomic<bool> asyncSqlReady_; // asyncSql_ 已由事件循环启用
+    std::atomic<bool> firstByte_;     // 是否已发出第一个响应字节
+
+    int wakeupFd_;
+    std::mutex pendingMtx_;
+    std::vector<std::function<void()>> pendingFunctors_;
+
+    MetricHistogram *fastLaneHist_;  // 普通请求：分派到响应就绪
+    MetricHistogram *dbLaneHist_;    // 数据库请求：分派到校验完成
+    MetricHistogram *queueWaitHist_; // 工作线程池排队时间
+    MetricGauge *timerGauge_;        // 定时器个数，由事件循环更新
+    MetricCounter *shedRequests_;    // 过载或排队超时返回的 503
+
+    int adminPort_;
+    int adminFd_;
+    std::thread adminThread_;
+    std::atomic<bool> adminStop_;
+
+    unsigned long long shedCount_; // 过载丢弃的请求数
+
+    unsigned long long acceptCount_;   // 成功 accept 的连接数
+    unsigned long long acceptReject_;  // fd 耗尽或连接数已满被拒绝的连接数
+    unsigned long long acceptDeferred_; // 用完 accept 预算后推迟到下一轮的次数
+
+    std::chrono::steady_clock::time_point lastStats_;
+    std::chrono::steady_clock::time_point lastPoolCheck_;
 };
 
 #endif
\ No newline at end of file
@@ -2,8 +2,9 @@
 #include <unistd.h>
 #include <cassert>
 
-Epoll::Epoll(int maxEvent):events_(maxEvent),epollFd_(epoll_create(512)){
-    assert(epollFd_>=0 && events_.size()>0);
+Epoll::Epoll(int maxEvent,int maxFd):epollFd_(epoll_create(512)),events_(maxEvent),
+    maxFd_(maxFd),interest_(new std::atomic<uint32_t>[maxFd]()),ctlCount_(0),ctlSkipped_(0){
+    assert(epollFd_>=0 && events_.size()>0 && maxFd_>0);
 }
 
 Epoll::~Epoll(){
@@ -15,25 +16,48 @@ bool Epoll::AddFd(int fd,uint32_t events){
     epoll_event ev={0};
     ev.data.fd=fd;
     ev.events=events;
-    return epoll_ctl(epollFd_,EPOLL_CTL_ADD,fd,&ev)==0;
+    ctlCount_++;
+    // 先更新缓存再调用 epoll_ctl：事件可能在调用返回前就被 Wait 取走并清零
+    if(fd<maxFd_)   interest_[fd]=events;
+    if(epoll_ctl(epollFd_,EPOLL_CTL_ADD,fd,&ev)==0)   return true;
+    if(fd<maxFd_)   interest_[fd]=0;
+    return false;
 }
 
 bool Epoll::ModFd(int fd,uint32_t events){
     if(fd<0)    return false;
+    if(fd<maxFd_ && interest_[fd].load(std::memory_order_relaxed)==events){
+        ctlSkipped_++;
+        return true;
+    }
     epoll_event ev={0};
     ev.data.fd=fd;
     ev.events=events;
-    return epoll_ctl(epollFd_,EPOLL_CTL_MOD,fd,&ev)==0;
+    ctlCount_++;
+    if(fd<maxFd_)   interest_[fd]=events;
+    if(epoll_ctl(epollFd_,EPOLL_CTL_MOD,fd,&ev)==0)   return true;
+    if(fd<maxFd_)   interest_[fd]=0;
+    return false;
 }
 
 bool Epoll::DelFd(int fd){
     if(fd<0)    return false;
+    if(fd<maxFd_)   interest_[fd]=0;
     epoll_event ev={0};
+    ctlCount_++;
     return epoll_ctl(epollFd_,EPOLL_CTL_DEL,fd,&ev)==0;
 }
 
 int Epoll::Wait(int timeoutMs){
-    return epoll_wait(epollFd_,&events_[0],static_cast<int>(events_.size()),timeoutMs);
+    int n=epoll_wait(epollFd_,&events_[0],static_cast<int>(events_.size()),timeoutMs);
+    for(int i=0;i<n;i++){
+        int fd=events_[i].data.fd;
+        // ONESHOT 的 fd 已被内核禁用，下次 ModFd 必须真正重新注册
+        if(fd>=0 && fd<maxFd_ && (interest_[fd]&EPOLLONESHOT)){
+            interest_[fd]=0;
+        }
+    }
+    return n;
 }
 
 int Epoll::GetEventFd(std::size_t i) const{
@@ -44,4 +68,4 @@ int Epoll::GetEventFd(std::size_t i) const{
 uint32_t Epoll::GetEvents(std::size_t i) const{
     assert(i<events_.size() && i>=0);
     return events_[i].events;
-}
\ No newline at end of file
+}
@@ -2,15 +2,17 @@
 #define EPOLL_H
 
 #include <vector>
+#include <atomic>
+#include <memory>
 #include <sys/epoll.h>
 
 class Epoll{
 public:
-    explicit Epoll(int maxEvent=1024);
+    explicit Epoll(int maxEvent=1024, int maxFd=65536);
     ~Epoll();
 
     bool AddFd(int fd,uint32_t events); //注册事件
-    bool ModFd(int fd,uint32_t events); //修改监听事件
+    bool ModFd(int fd,uint32_t events); //修改监听事件，与已注册的事件相同时不调用 epoll_ctl
     bool DelFd(int fd); //删除fd
 
     int Wait(int timeoutMs=-1); // 将就绪的事件从内核事件表中复制到它的第二个参数 events 指向的数组
@@ -20,9 +22,18 @@ public:
 
     uint32_t GetEvents(size_t i) const;
 
+    unsigned long long CtlCount() const { return ctlCount_; }       // 实际调用 epoll_ctl 的次数
+    unsigned long long CtlSkipped() const { return ctlSkipped_; }   // 因事件未变化而省去的次数
+
 private:
     int epollFd_;
     std::vector<struct epoll_event> events_;
+
+    // 每个 fd 当前在内核中生效的事件；EPOLLONESHOT 的 fd 触发后被内核禁用，记为 0
+    int maxFd_;
+    std::unique_ptr<std::atomic<uint32_t>[]> interest_;
+    std::atomic<unsigned long long> ctlCount_;
+    std::atomic<unsigned long long> ctlSkipped_;
 };
 
-#endif
\ No newline at end of file
+#endif
@@ -0,0 +1,214 @@
+#include "log_user_store.h"
+#include "../log/log.h"
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include <cstring>
+#include <cerrno>
+#include <mutex>
+#include <cassert>
+
+LogUserStore::~LogUserStore()
+{
+    if (fd_ >= 0)
+    {
+        close(fd_);
+    }
+}
+
+// FNV-1a
+uint32_t LogUserStore::Checksum_(const char *data, size_t len)
+{
+    uint32_t h = 2166136261u;
+    for (size_t i = 0; i < len; i++)
+    {
+        h ^= (unsigned char)data[i];
+        h *= 16777619u;
+    }
+    return h;
+}
+
+void LogUserStore::Encode_(std::string *out, const std::string &name, const std::string &pwd)
+{
+    size_t begin = out->size();
+    uint16_t nameLen = name.size(), pwdLen = pwd.size();
+    out->resize(begin + HEADER_SIZE);
+    memcpy(&(*out)[begin + 4], &nameLen, 2);
+    memcpy(&(*out)[begin + 6], &pwdLen, 2);
+    out->append(name);
+    out->append(pwd);
+    uint32_t sum = Checksum_(out->data() + begin + 4, out->size() - begin - 4);
+    memcpy(&(*out)[begin], &sum, 4);
+}
+
+bool LogUserStore::WriteAll_(int fd, const char *data, size_t len)
+{
+    while (len > 0)
+    {
+        ssize_t n = write(fd, data, len);
+        if (n < 0)
+        {
+            if (errno == EINTR)
+            {
+                continue;
+            }
+            return false;
+        }
+        data += n;
+        len -= n;
+    }
+    return true;
+}
+
+bool LogUserStore::SyncDir_(const std::string &path)
+{
+    size_t slash = path.rfind('/');
+    std::string dir = slash == std::string::npos ? "." : (slash == 0 ? "/" : path.substr(0, slash));
+    int fd = open(dir.c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+    if (fd < 0)
+    {
+        return false;
+    }
+    bool ok = fsync(fd) == 0;
+    close(fd);
+    return ok;
+}
+
+bool LogUserStore::Open(const std::string &path, bool syncWrite)
+{
+    std::unique_lock<std::shared_timed_mutex> locker(mtx_);
+    assert(fd_ < 0);
+    path_ = path;
+    syncWrite_ = syncWrite;
+    bool created = false;
+    fd_ = open(path_.c_str(), O_RDWR | O_APPEND | O_CLOEXEC);
+    if (fd_ < 0 && errno == ENOENT)
+    {
+        fd_ = open(path_.c_str(), O_RDWR | O_CREAT | O_APPEND | O_CLOEXEC, 0644);
+        created = true;
+    }
+    if (fd_ < 0)
+    {
+        LOG_ERROR("Open user store %s error: %s", path_.c_str(), strerror(errno));
+        return false;
+    }
+    // 新建文件的目录项不落盘，掉电后整个日志可能连同已确认的注册一起消失
+    if (created && syncWrite_ && !SyncDir_(path_))
+    {
+        LOG_ERROR("Sync user store dir error: %s", strerror(errno));
+        close(fd_);
+        fd_ = -1;
+        return false;
+    }
+    if (!Replay_())
+    {
+        close(fd_);
+        fd_ = -1;
+        return false;
+    }
+    LOG_INFO("User store %s: %d users, %d bytes", path_.c_str(), (int)users_.size(), (int)fileBytes_);
+    return true;
+}
+
+bool LogUserStore::Replay_()
+{
+    struct stat st;
+    if (fstat(fd_, &st) < 0)
+    {
+        return false;
+    }
+    std::string data(st.st_size, '\0');
+    size_t got = 0;
+    while (got < data.size())
+    {
+        ssize_t n = pread(fd_, &data[got], data.size() - got, got);
+        if (n < 0 && errno == EINTR)
+        {
+            continue;
+        }
+        if (n <= 0)
+        {
+            LOG_ERROR("Read user store %s error: %s", path_.c_str(), strerror(errno));
+            return false;
+        }
+        got += n;
+    }
+
+    size_t off = 0;
+    while (off + HEADER_SIZE <= data.size())
+    {
+        uint32_t sum;
+        uint16_t nameLen, pwdLen;
+        memcpy(&sum, &data[off], 4);
+        memcpy(&nameLen, &data[off + 4], 2);
+        memcpy(&pwdLen, &data[off + 6], 2);
+        size_t len = HEADER_SIZE + nameLen + pwdLen;
+        if (off + len > data.size() || Checksum_(&data[off + 4], len - 4) != sum)
+        {
+            break;
+        }
+        users_.emplace(data.substr(off + HEADER_SIZE, nameLen), data.substr(off + HEADER_SIZE + nameLen, pwdLen));
+        off += len;
+    }
+    if (off < data.size())
+    {
+        // 崩溃时写了一半的记录，截断后继续追加
+        LOG_WARN("User store %s: truncate %d bytes of torn tail", path_.c_str(), (int)(data.size() - off));
+        if (ftruncate(fd_, off) < 0)
+        {
+            return false;
+        }
+    }
+    fileBytes_ = off;
+    return true;
+}
+
+int LogUserStore::GetPassword(const std::string &name, std::string *pwd, const Deadline &)
+{
+    std::shared_lock<std::shared_timed_mutex> locker(mtx_);
+    auto it = users_.find(name);
+    if (it == users_.end())
+    {
+        return 0;
+    }
+    *pwd = it->second;
+    return 1;
+}
+
+int LogUserStore::AddUser(const std::string &name, const std::string &pwd, const Deadline &)
+{
+    if (name.size() > UINT16_MAX || pwd.size() > UINT16_MAX)
+    {
+        return STORE_ERROR;
+    }
+    std::string record;
+    Encode_(&record, name, pwd);
+
+    std::unique_lock<std::shared_timed_mutex> locker(mtx_);
+    if (fd_ < 0 || users_.count(name))
+    {
+        return STORE_ERROR;
+    }
+    if (!WriteAll_(fd_, record.data(), record.size()) || (syncWrite_ && fdatasync(fd_) < 0))
+    {
+        LOG_ERROR("Append user store error: %s", strerror(errno));
+        if (ftruncate(fd_, fileBytes_) < 0)
+        {
+            LOG_ERROR("Truncate user store error: %s", strerror(errno));
+        }
+        return STORE_ERROR;
+    }
+    users_.emplace(name, pwd);
+    fileBytes_ += record.size();
+    return 0;
+}
+
+bool LogUserStore::ForEachUser(const std::function<void(const std::string &name)> &fn)
+{
+    std::shared_lock<std::shared_timed_mutex> locker(mtx_);
+    for (auto &user : users_)
+    {
+        fn(user.first);
+    }
+    return true;
+}
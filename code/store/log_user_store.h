@@ -0,0 +1,51 @@
+//
+// 嵌入式用户存储：只追加的日志文件 + 内存哈希索引，启动时重放日志
+// 记录格式：[u32 校验和][u16 用户名长度][u16 密码长度][用户名][密码]
+// 用户只增不改不删，日志里没有失效记录，因此不做压缩
+//
+#ifndef LOG_USER_STORE_H
+#define LOG_USER_STORE_H
+
+#include "user_store.h"
+#include <shared_mutex>
+#include <unordered_map>
+#include <cstdint>
+
+class LogUserStore : public UserStore
+{
+public:
+    LogUserStore() = default;
+    ~LogUserStore();
+
+    // 打开并重放日志，末尾写了一半的记录会被截断；syncWrite 为 true 时每次写入都 fdatasync，新建文件时同步所在目录
+    bool Open(const std::string &path, bool syncWrite = true);
+
+    // 本地内存查找与追加写都很快，忽略截止时间
+    int GetPassword(const std::string &name, std::string *pwd, const Deadline &deadline) override;
+    int AddUser(const std::string &name, const std::string &pwd, const Deadline &deadline) override;
+    bool ForEachUser(const std::function<void(const std::string &name)> &fn) override;
+    const char *Name() const override { return "log"; }
+
+    LogUserStore(const LogUserStore &) = delete;
+    LogUserStore &operator=(const LogUserStore &) = delete;
+
+private:
+    static const size_t HEADER_SIZE = 8;
+
+    static uint32_t Checksum_(const char *data, size_t len);
+    static void Encode_(std::string *out, const std::string &name, const std::string &pwd);
+    static bool WriteAll_(int fd, const char *data, size_t len);
+    static bool SyncDir_(const std::string &path); // fsync 文件所在目录，使新建的目录项落盘
+
+    bool Replay_(); // 调用方需持有写锁
+
+    std::string path_;
+    int fd_ = -1;
+    bool syncWrite_ = true;
+
+    std::shared_timed_mutex mtx_; // 查询共享，写入独占
+    std::unordered_map<std::string, std::string> users_;
+    size_t fileBytes_ = 0; // 已确认完整的日志长度，追加失败时截断回这里
+};
+
+#endif
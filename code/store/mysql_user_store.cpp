@@ -0,0 +1,192 @@
+#include "mysql_user_store.h"
+#include "../pool/sql_connect_RAII.h"
+#include <algorithm>
+
+// 查询用户密码：找到返回 1，不存在返回 0，出错返回 -1
+int MySqlUserStore::QueryPassword_(SqlStmtCache *stmts, const std::string &name, std::string *pwd)
+{
+    MYSQL_BIND param[1] = {};
+    unsigned long nameLen = name.size();
+    param[0].buffer_type = MYSQL_TYPE_STRING;
+    param[0].buffer = const_cast<char *>(name.data());
+    param[0].buffer_length = nameLen;
+    param[0].length = &nameLen;
+
+    MYSQL_STMT *stmt = nullptr;
+    if (stmts->Execute(STMT_QUERY_PASSWORD, param, &stmt))
+    {
+        return -1;
+    }
+
+    char buff[128];
+    unsigned long len = 0;
+    MYSQL_BIND result[1] = {};
+    result[0].buffer_type = MYSQL_TYPE_STRING;
+    result[0].buffer = buff;
+    result[0].buffer_length = sizeof(buff);
+    result[0].length = &len;
+    if (mysql_stmt_bind_result(stmt, result) || mysql_stmt_store_result(stmt))
+    {
+        mysql_stmt_free_result(stmt);
+        return -1;
+    }
+
+    int ret = mysql_stmt_fetch(stmt);
+    int found = -1;
+    if (ret == MYSQL_NO_DATA)
+    {
+        found = 0;
+    }
+    else if (ret == 0 || ret == MYSQL_DATA_TRUNCATED)
+    {
+        pwd->assign(buff, std::min<unsigned long>(len, sizeof(buff)));
+        if (len > sizeof(buff))
+        {
+            // 密码超出缓冲区，按实际长度重新取整列
+            pwd->resize(len);
+            result[0].buffer = &(*pwd)[0];
+            result[0].buffer_length = len;
+            if (mysql_stmt_fetch_column(stmt, result, 0, 0))
+            {
+                pwd->clear();
+            }
+        }
+        found = pwd->empty() ? -1 : 1;
+    }
+    mysql_stmt_free_result(stmt);
+    return found;
+}
+
+bool MySqlUserStore::InsertUser_(SqlStmtCache *stmts, const std::string &name, const std::string &pwd)
+{
+    MYSQL_BIND param[2] = {};
+    unsigned long nameLen = name.size();
+    unsigned long pwdLen = pwd.size();
+    param[0].buffer_type = MYSQL_TYPE_STRING;
+    param[0].buffer = const_cast<char *>(name.data());
+    param[0].buffer_length = nameLen;
+    param[0].length = &nameLen;
+    param[1].buffer_type = MYSQL_TYPE_STRING;
+    param[1].buffer = const_cast<char *>(pwd.data());
+    param[1].buffer_length = pwdLen;
+    param[1].length = &pwdLen;
+
+    MYSQL_STMT *stmt = nullptr;
+    unsigned int err = stmts->Execute(STMT_INSERT_USER, param, &stmt);
+    if (err)
+    {
+        LOG_DEBUG("Insert error(%u)!", err);
+        return false;
+    }
+    return true;
+}
+
+bool MySqlUserStore::Expired_(const Deadline &deadline, Deadline::STAGE stage)
+{
+    if (!deadline.Expired())
+    {
+        return false;
+    }
+    Deadline::CountExpired(stage);
+    return true;
+}
+
+MYSQL *MySqlUserStore::GetConn_(const Deadline &deadline, int *err)
+{
+    if (Expired_(deadline, Deadline::DB_CONN))
+    {
+        *err = STORE_EXPIRED;
+        return nullptr;
+    }
+    MYSQL *sql = connPool_->GetConn(deadline.RemainingMs(SqlConnPool::DEFAULT_WAIT_MS));
+    if (!sql)
+    {
+        *err = Expired_(deadline, Deadline::DB_CONN) ? STORE_EXPIRED : STORE_ERROR;
+        return nullptr;
+    }
+    if (Expired_(deadline, Deadline::DB_QUERY))
+    {
+        connPool_->FreeConn(sql);
+        *err = STORE_EXPIRED;
+        return nullptr;
+    }
+    return sql;
+}
+
+int MySqlUserStore::GetPassword(const std::string &name, std::string *pwd, const Deadline &deadline)
+{
+    int err = STORE_ERROR;
+    MYSQL *sql = GetConn_(deadline, &err);
+    if (!sql)
+    {
+        return err;
+    }
+    SqlConnRAII connRAII(sql, connPool_);
+    SqlStmtCache *stmts = connPool_->GetStmtCache(sql);
+    if (!stmts)
+    {
+        return STORE_ERROR;
+    }
+    // 参数直接绑定到预处理语句，无需转义
+    return QueryPassword_(stmts, name, pwd);
+}
+
+int MySqlUserStore::AddUser(const std::string &name, const std::string &pwd, const Deadline &deadline)
+{
+    // 组提交在不持有连接的情况下等待批次
+    if (batcher_)
+    {
+        unsigned int err = batcher_->Insert(name, pwd, deadline);
+        if (err == SqlInsertBatcher::EXPIRED)
+        {
+            return STORE_EXPIRED;
+        }
+        if (err)
+        {
+            LOG_DEBUG("Insert error(%u)!", err);
+            return STORE_ERROR;
+        }
+        return 0;
+    }
+    int err = STORE_ERROR;
+    MYSQL *sql = GetConn_(deadline, &err);
+    if (!sql)
+    {
+        return err;
+    }
+    SqlConnRAII connRAII(sql, connPool_);
+    SqlStmtCache *stmts = connPool_->GetStmtCache(sql);
+    return stmts && InsertUser_(stmts, name, pwd) ? 0 : STORE_ERROR;
+}
+
+bool MySqlUserStore::ForEachUser(const std::function<void(const std::string &name)> &fn)
+{
+    MYSQL *sql = nullptr;
+    SqlConnRAII connRAII(&sql, connPool_);
+    if (!sql)
+    {
+        return false;
+    }
+    // 逐行读取，不把整张表缓存在客户端
+    if (mysql_query(sql, "SELECT username FROM user") != 0)
+    {
+        LOG_WARN("Scan user table error: %s", mysql_error(sql));
+        return false;
+    }
+    MYSQL_RES *res = mysql_use_result(sql);
+    if (!res)
+    {
+        LOG_WARN("Scan user table error: %s", mysql_error(sql));
+        return false;
+    }
+    while (MYSQL_ROW row = mysql_fetch_row(res))
+    {
+        if (row[0])
+        {
+            fn(row[0]);
+        }
+    }
+    bool ok = mysql_errno(sql) == 0;
+    mysql_free_result(res);
+    return ok;
+}
@@ -0,0 +1,34 @@
+//
+// 基于连接池与预处理语句的 MySQL 用户存储
+//
+#ifndef MYSQL_USER_STORE_H
+#define MYSQL_USER_STORE_H
+
+#include "user_store.h"
+#include "../pool/sql_connect_pool.h"
+#include "../pool/sql_batch.h"
+
+class MySqlUserStore : public UserStore
+{
+public:
+    // batcher 不为空时注册插入走组提交
+    explicit MySqlUserStore(SqlConnPool *connPool, SqlInsertBatcher *batcher = nullptr)
+        : connPool_(connPool), batcher_(batcher) {}
+
+    // 截止时间限制获取连接的等待，拿到连接后已过期则不再执行语句
+    int GetPassword(const std::string &name, std::string *pwd, const Deadline &deadline) override;
+    int AddUser(const std::string &name, const std::string &pwd, const Deadline &deadline) override;
+    bool ForEachUser(const std::function<void(const std::string &name)> &fn) override;
+    const char *Name() const override { return "mysql"; }
+
+private:
+    static bool Expired_(const Deadline &deadline, Deadline::STAGE stage); // 过期时按阶段计数
+    MYSQL *GetConn_(const Deadline &deadline, int *err);                   // 失败时 err 为 STORE_ERROR / STORE_EXPIRED
+    static int QueryPassword_(SqlStmtCache *stmts, const std::string &name, std::string *pwd);
+    static bool InsertUser_(SqlStmtCache *stmts, const std::string &name, const std::string &pwd);
+
+    SqlConnPool *connPool_;
+    SqlInsertBatcher *batcher_;
+};
+
+#endif
@@ -0,0 +1,34 @@
+//
+// 用户数据存储接口：MySQL 实现与嵌入式日志实现，启动时选择
+//
+#ifndef USER_STORE_H
+#define USER_STORE_H
+
+#include <string>
+#include <functional>
+#include "../timer/deadline.h"
+
+class UserStore
+{
+public:
+    virtual ~UserStore() = default;
+
+    enum
+    {
+        STORE_ERROR = -1,
+        STORE_EXPIRED = -2, // 请求已过截止时间，未访问后端
+    };
+
+    // 查询密码：1 用户存在，0 不存在，否则返回 STORE_ERROR / STORE_EXPIRED
+    virtual int GetPassword(const std::string &name, std::string *pwd, const Deadline &deadline) = 0;
+
+    // 新增用户，成功返回 0，否则返回 STORE_ERROR / STORE_EXPIRED；调用方应先确认用户名不存在
+    virtual int AddUser(const std::string &name, const std::string &pwd, const Deadline &deadline) = 0;
+
+    // 遍历全部用户名（启动时加载索引用），出错返回 false
+    virtual bool ForEachUser(const std::function<void(const std::string &name)> &fn) = 0;
+
+    virtual const char *Name() const = 0;
+};
+
+#endif
@@ -0,0 +1,197 @@
+#include "fake_mysql.h"
+#include <mysql/mysql.h>
+#include <mysql/errmsg.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <cerrno>
+#include <cstring>
+#include <mutex>
+#include <queue>
+#include <string>
+#include <unordered_map>
+
+namespace
+{
+    struct FakeConn
+    {
+        bool blocked = false; // 本条查询已模拟过一次发送阻塞
+        bool sent = false;
+        unsigned int err = 0;
+        std::string errMsg;
+    };
+
+    std::mutex mtx;
+    bool refuse = false;
+    bool blockSend = false;
+    std::queue<int> serverFds;
+    std::unordered_map<MYSQL *, FakeConn> conns;
+    char dummyResult;
+
+    void SetError_(MYSQL *sql, unsigned int err, const char *msg)
+    {
+        std::lock_guard<std::mutex> locker(mtx);
+        conns[sql].err = err;
+        conns[sql].errMsg = msg;
+    }
+}
+
+namespace fake_mysql
+{
+    void SetRefuse(bool r)
+    {
+        std::lock_guard<std::mutex> locker(mtx);
+        refuse = r;
+    }
+
+    void SetBlockSend(bool block)
+    {
+        std::lock_guard<std::mutex> locker(mtx);
+        blockSend = block;
+    }
+
+    int TakeServerFd()
+    {
+        std::lock_guard<std::mutex> locker(mtx);
+        if (serverFds.empty())
+        {
+            return -1;
+        }
+        int fd = serverFds.front();
+        serverFds.pop();
+        return fd;
+    }
+
+    int OpenConns()
+    {
+        std::lock_guard<std::mutex> locker(mtx);
+        return (int)conns.size();
+    }
+}
+
+extern "C"
+{
+    MYSQL *mysql_init(MYSQL *)
+    {
+        MYSQL *sql = new MYSQL();
+        sql->net.fd = -1;
+        std::lock_guard<std::mutex> locker(mtx);
+        conns[sql] = FakeConn();
+        return sql;
+    }
+
+    int mysql_options(MYSQL *, enum mysql_option, const void *)
+    {
+        return 0;
+    }
+
+    MYSQL *mysql_real_connect(MYSQL *sql, const char *, const char *, const char *, const char *,
+                              unsigned int, const char *, unsigned long)
+    {
+        {
+            std::lock_guard<std::mutex> locker(mtx);
+            if (!refuse)
+            {
+                int fds[2];
+                if (socketpair(AF_UNIX, SOCK_STREAM, 0, fds) == 0)
+                {
+                    fcntl(fds[0], F_SETFL, fcntl(fds[0], F_GETFL) | O_NONBLOCK);
+                    sql->net.fd = fds[0];
+                    serverFds.push(fds[1]);
+                    return sql;
+                }
+            }
+        }
+        SetError_(sql, CR_UNKNOWN_ERROR, "connection refused");
+        return nullptr;
+    }
+
+    void mysql_close(MYSQL *sql)
+    {
+        if (!sql)
+        {
+            return;
+        }
+        if (sql->net.fd >= 0)
+        {
+            close(sql->net.fd);
+        }
+        {
+            std::lock_guard<std::mutex> locker(mtx);
+            conns.erase(sql);
+        }
+        delete sql;
+    }
+
+    const char *mysql_error(MYSQL *sql)
+    {
+        std::lock_guard<std::mutex> locker(mtx);
+        return conns[sql].errMsg.c_str();
+    }
+
+    unsigned int mysql_errno(MYSQL *sql)
+    {
+        std::lock_guard<std::mutex> locker(mtx);
+        return conns[sql].err;
+    }
+
+    unsigned long mysql_real_escape_string(MYSQL *, char *to, const char *from, unsigned long length)
+    {
+        memcpy(to, from, length);
+        to[length] = '\0';
+        return length;
+    }
+
+    enum net_async_status mysql_real_query_nonblocking(MYSQL *sql, const char *query, unsigned long length)
+    {
+        bool sent;
+        {
+            std::lock_guard<std::mutex> locker(mtx);
+            FakeConn &conn = conns[sql];
+            if (blockSend && !conn.sent && !conn.blocked)
+            {
+                conn.blocked = true;
+                return NET_ASYNC_NOT_READY; // 连接仍然可写，只有可写事件会再次调用
+            }
+            sent = conn.sent;
+            conn.sent = true;
+        }
+        if (!sent && write(sql->net.fd, query, length) != (ssize_t)length)
+        {
+            SetError_(sql, CR_SERVER_GONE_ERROR, "MySQL server has gone away");
+            return NET_ASYNC_ERROR;
+        }
+        char reply;
+        ssize_t len = read(sql->net.fd, &reply, 1);
+        if (len < 0 && (errno == EAGAIN || errno == EWOULDBLOCK))
+        {
+            return NET_ASYNC_NOT_READY;
+        }
+        {
+            std::lock_guard<std::mutex> locker(mtx);
+            conns[sql].sent = false;
+            conns[sql].blocked = false;
+        }
+        if (len <= 0)
+        {
+            SetError_(sql, CR_SERVER_LOST, "Lost connection to MySQL server during query");
+            return NET_ASYNC_ERROR;
+        }
+        if (reply != 'O')
+        {
+            SetError_(sql, 1064, "You have an error in your SQL syntax");
+            return NET_ASYNC_ERROR;
+        }
+        return NET_ASYNC_COMPLETE;
+    }
+
+    enum net_async_status mysql_store_result_nonblocking(MYSQL *, MYSQL_RES **result)
+    {
+        *result = reinterpret_cast<MYSQL_RES *>(&dummyResult);
+        return NET_ASYNC_COMPLETE;
+    }
+
+    void mysql_free_result(MYSQL_RES *)
+    {
+    }
+}
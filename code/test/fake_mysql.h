@@ -0,0 +1,17 @@
+//
+// 测试用的 MySQL 客户端库替身，只实现 AsyncSqlClient 用到的接口
+// 每条连接是一对 socketpair，服务端一端交给测试代码控制：
+// 查询发出后从连接读 1 字节应答，'O' 表示成功，'E' 表示 SQL 错误，对端关闭表示连接断开
+//
+#ifndef FAKE_MYSQL_H
+#define FAKE_MYSQL_H
+
+namespace fake_mysql
+{
+    void SetRefuse(bool refuse); // 之后的 mysql_real_connect 全部失败
+    void SetBlockSend(bool block); // 之后每条查询第一次发送都像发送缓冲区已满一样返回 NOT_READY
+    int TakeServerFd();          // 取出最早一条尚未取走的连接的服务端 fd，没有返回 -1
+    int OpenConns();             // 尚未 mysql_close 的连接数
+}
+
+#endif
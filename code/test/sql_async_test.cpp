@@ -0,0 +1,384 @@
+//
+// AsyncSqlClient 的出错、断开与重连路径，MySQL 由 fake_mysql 替身模拟
+//
+#include "../pool/sql_async.h"
+#include "fake_mysql.h"
+#include <sys/epoll.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#include <csignal>
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+#include <unordered_map>
+
+#define CHECK(cond)                                                          \
+    do                                                                       \
+    {                                                                        \
+        if (!(cond))                                                         \
+        {                                                                    \
+            fprintf(stderr, "%s:%d: CHECK(%s) failed\n", __FILE__, __LINE__, #cond); \
+            exit(1);                                                         \
+        }                                                                    \
+    } while (0)
+
+#ifdef HAVE_MYSQL_NONBLOCKING
+
+namespace
+{
+    // 单线程的最小事件循环：epoll 分发连接事件，重连线程经 Post 投递任务
+    class Loop
+    {
+    public:
+        Loop() : epollFd_(epoll_create1(0)) { CHECK(epollFd_ >= 0); }
+        ~Loop() { close(epollFd_); }
+
+        bool AddFd(int fd)
+        {
+            epoll_event ev = {};
+            ev.events = EPOLLIN;
+            ev.data.fd = fd;
+            events_[fd] = ev.events;
+            return epoll_ctl(epollFd_, EPOLL_CTL_ADD, fd, &ev) == 0;
+        }
+
+        bool ModFd(int fd, uint32_t events)
+        {
+            epoll_event ev = {};
+            ev.events = events;
+            ev.data.fd = fd;
+            events_[fd] = events;
+            return epoll_ctl(epollFd_, EPOLL_CTL_MOD, fd, &ev) == 0;
+        }
+
+        uint32_t Events(int fd) { return events_[fd]; } // 最近一次注册的事件
+
+        void Post(std::function<void()> task)
+        {
+            std::lock_guard<std::mutex> locker(mtx_);
+            tasks_.push_back(std::move(task));
+        }
+
+        // 运行直到 pred 成立或超时，返回 pred 是否成立
+        bool RunUntil(AsyncSqlClient &client, const std::function<bool()> &pred, int timeoutMs = 3000)
+        {
+            auto end = std::chrono::steady_clock::now() + std::chrono::milliseconds(timeoutMs);
+            while (std::chrono::steady_clock::now() < end)
+            {
+                RunTasks();
+                if (pred())
+                {
+                    return true;
+                }
+                epoll_event events[8];
+                int n = epoll_wait(epollFd_, events, 8, 10);
+                for (int i = 0; i < n; i++)
+                {
+                    if (client.Owns(events[i].data.fd))
+                    {
+                        client.OnEvent(events[i].data.fd);
+                    }
+                }
+            }
+            RunTasks();
+            return pred();
+        }
+
+        void RunTasks()
+        {
+            std::vector<std::function<void()>> tasks;
+            {
+                std::lock_guard<std::mutex> locker(mtx_);
+                tasks.swap(tasks_);
+            }
+            for (auto &task : tasks)
+            {
+                task();
+            }
+        }
+
+    private:
+        int epollFd_;
+        std::unordered_map<int, uint32_t> events_;
+        std::mutex mtx_;
+        std::vector<std::function<void()>> tasks_;
+    };
+
+    struct Result
+    {
+        bool done = false;
+        bool ok = false;
+    };
+
+    AsyncSqlClient::QueryCallBack Record(Result &result)
+    {
+        return [&result](MYSQL_RES *res)
+        {
+            CHECK(!result.done);
+            result.done = true;
+            result.ok = res != nullptr;
+        };
+    }
+
+    void Reply(int serverFd, char reply)
+    {
+        CHECK(write(serverFd, &reply, 1) == 1);
+    }
+
+    void InitClient(AsyncSqlClient &client, Loop &loop, int connSize)
+    {
+        CHECK(client.Init("localhost", 3306, "root", "root", "test", connSize, [&loop](int fd)
+                          { return loop.AddFd(fd); }));
+        client.EnableReconnect([&loop](int fd)
+                               { return loop.AddFd(fd); },
+                               [&loop](std::function<void()> task)
+                               { loop.Post(std::move(task)); });
+        client.SetModFd([&loop](int fd, uint32_t events)
+                        { return loop.ModFd(fd, events); });
+    }
+
+    // 关闭客户端后处理掉重连线程可能留下的任务，确认没有泄漏连接
+    void Shutdown(AsyncSqlClient &client, Loop &loop, std::vector<int> &serverFds)
+    {
+        client.Close();
+        loop.RunTasks();
+        for (int fd : serverFds)
+        {
+            close(fd);
+        }
+        for (int fd = fake_mysql::TakeServerFd(); fd >= 0; fd = fake_mysql::TakeServerFd())
+        {
+            close(fd);
+        }
+        CHECK(fake_mysql::OpenConns() == 0);
+    }
+
+    // 查询出错时排队的查询不能派到刚断开的连接上：两个回调都要触发，InFlight 归零
+    void TestErrorWithPending()
+    {
+        Loop loop;
+        AsyncSqlClient client;
+        InitClient(client, loop, 1);
+        std::vector<int> serverFds{fake_mysql::TakeServerFd()};
+
+        Result first, second;
+        CHECK(client.Query("SELECT 1", Record(first)));
+        CHECK(client.Query("SELECT 2", Record(second)));
+        CHECK(client.InFlight() == 1 && client.Pending() == 1);
+
+        Reply(serverFds[0], 'E');
+        CHECK(loop.RunUntil(client, [&]
+                            { return first.done && second.done; }));
+        CHECK(!first.ok && !second.ok);
+        CHECK(client.InFlight() == 0 && client.Pending() == 0);
+        CHECK(client.LiveConns() == 0);
+        CHECK(!client.Query("SELECT 3", Record(first)));
+
+        // 重连后恢复服务
+        CHECK(loop.RunUntil(client, [&]
+                            { return client.LiveConns() == 1; }));
+        serverFds.push_back(fake_mysql::TakeServerFd());
+        Result third;
+        CHECK(client.Query("SELECT 3", Record(third)));
+        Reply(serverFds[1], 'O');
+        CHECK(loop.RunUntil(client, [&]
+                            { return third.done; }));
+        CHECK(third.ok && client.InFlight() == 0);
+        Shutdown(client, loop, serverFds);
+        printf("[PASS] error with pending query\n");
+    }
+
+    // 一条连接出错时，排队的查询交给仍存活的连接执行
+    void TestPendingMovesToLiveConn()
+    {
+        Loop loop;
+        AsyncSqlClient client;
+        InitClient(client, loop, 2);
+        std::vector<int> serverFds{fake_mysql::TakeServerFd(), fake_mysql::TakeServerFd()};
+
+        Result a, b, c;
+        CHECK(client.Query("SELECT a", Record(a)));
+        CHECK(client.Query("SELECT b", Record(b)));
+        CHECK(client.Query("SELECT c", Record(c)));
+        CHECK(client.InFlight() == 2 && client.Pending() == 1);
+
+        // 拒绝重连，保证 c 只能由存活的连接执行
+        fake_mysql::SetRefuse(true);
+        Reply(serverFds[0], 'E');
+        CHECK(loop.RunUntil(client, [&]
+                            { return a.done; }));
+        CHECK(!a.ok && !c.done && client.LiveConns() == 1);
+
+        Reply(serverFds[1], 'O');
+        Reply(serverFds[1], 'O');
+        CHECK(loop.RunUntil(client, [&]
+                            { return b.done && c.done; }));
+        CHECK(b.ok && c.ok);
+        CHECK(client.InFlight() == 0 && client.Pending() == 0);
+        fake_mysql::SetRefuse(false);
+        Shutdown(client, loop, serverFds);
+        printf("[PASS] pending query moves to live connection\n");
+    }
+
+    // 查询途中服务端断开
+    void TestEofDuringQuery()
+    {
+        Loop loop;
+        AsyncSqlClient client;
+        InitClient(client, loop, 1);
+        std::vector<int> serverFds;
+
+        Result first;
+        CHECK(client.Query("SELECT 1", Record(first)));
+        close(fake_mysql::TakeServerFd());
+        CHECK(loop.RunUntil(client, [&]
+                            { return first.done; }));
+        CHECK(!first.ok && client.InFlight() == 0);
+
+        CHECK(loop.RunUntil(client, [&]
+                            { return client.LiveConns() == 1; }));
+        serverFds.push_back(fake_mysql::TakeServerFd());
+        Result second;
+        CHECK(client.Query("SELECT 2", Record(second)));
+        Reply(serverFds[0], 'O');
+        CHECK(loop.RunUntil(client, [&]
+                            { return second.done; }));
+        CHECK(second.ok);
+        Shutdown(client, loop, serverFds);
+        printf("[PASS] EOF during query\n");
+    }
+
+    // 空闲连接被服务端关闭（如 wait_timeout），重连被拒绝期间保持不可用，恢复后重新连上
+    void TestIdleEofAndRefusedReconnect()
+    {
+        Loop loop;
+        AsyncSqlClient client;
+        InitClient(client, loop, 1);
+        std::vector<int> serverFds;
+
+        fake_mysql::SetRefuse(true);
+        close(fake_mysql::TakeServerFd());
+        CHECK(loop.RunUntil(client, [&]
+                            { return client.LiveConns() == 0; }));
+        Result first;
+        CHECK(!client.Query("SELECT 1", Record(first)));
+        CHECK(!loop.RunUntil(client, [&]
+                             { return client.LiveConns() > 0; }, 400));
+
+        fake_mysql::SetRefuse(false);
+        CHECK(loop.RunUntil(client, [&]
+                            { return client.LiveConns() == 1; }));
+        serverFds.push_back(fake_mysql::TakeServerFd());
+        CHECK(client.Query("SELECT 1", Record(first)));
+        Reply(serverFds[0], 'O');
+        CHECK(loop.RunUntil(client, [&]
+                            { return first.done; }));
+        CHECK(first.ok);
+        Shutdown(client, loop, serverFds);
+        printf("[PASS] idle EOF and refused reconnect\n");
+    }
+
+    // 排队期间过期的查询不再发送，以失败回调并计入 DB_QUEUE
+    void TestPendingExpires()
+    {
+        Loop loop;
+        AsyncSqlClient client;
+        InitClient(client, loop, 1);
+        std::vector<int> serverFds{fake_mysql::TakeServerFd()};
+        unsigned long long expiredBefore = Deadline::ExpiredCount(Deadline::DB_QUEUE);
+
+        Result first, second;
+        CHECK(client.Query("SELECT 1", Record(first)));
+        CHECK(client.Query("SELECT 2", Record(second),
+                           Deadline(Deadline::Clock::now() + std::chrono::milliseconds(20))));
+        CHECK(client.Pending() == 1);
+        std::this_thread::sleep_for(std::chrono::milliseconds(30));
+
+        Reply(serverFds[0], 'O');
+        CHECK(loop.RunUntil(client, [&]
+                            { return first.done && second.done; }));
+        CHECK(first.ok && !second.ok);
+        CHECK(client.InFlight() == 0 && client.Pending() == 0 && client.LiveConns() == 1);
+        CHECK(Deadline::ExpiredCount(Deadline::DB_QUEUE) == expiredBefore + 1);
+
+        // 服务端只收到第一条查询
+        char buf[64];
+        ssize_t len = read(serverFds[0], buf, sizeof(buf));
+        CHECK(len == 8 && std::string(buf, len) == "SELECT 1");
+        Shutdown(client, loop, serverFds);
+        printf("[PASS] pending query expires\n");
+    }
+
+    // 发送被阻塞的查询靠可写事件继续发送；发送完成后退回只关注可读，等待响应时不会因一直可写而空转
+    void TestBlockedSend()
+    {
+        Loop loop;
+        AsyncSqlClient client;
+        InitClient(client, loop, 1);
+        std::vector<int> serverFds{fake_mysql::TakeServerFd()};
+
+        fake_mysql::SetBlockSend(true);
+        Result first;
+        CHECK(client.Query("SELECT 1", Record(first)));
+        int fd = -1;
+        for (int i = 0; i < 1024 && fd < 0; i++)
+        {
+            fd = client.Owns(i) ? i : -1;
+        }
+        CHECK(fd >= 0 && (loop.Events(fd) & EPOLLOUT));
+
+        // 服务端收到查询即说明可写事件推进了发送
+        char buf[64];
+        CHECK(loop.RunUntil(client, [&]
+                            { return recv(serverFds[0], buf, sizeof(buf), MSG_DONTWAIT | MSG_PEEK) > 0; }));
+        CHECK(read(serverFds[0], buf, sizeof(buf)) == 8);
+        CHECK(!first.done);
+        Reply(serverFds[0], 'O');
+        CHECK(loop.RunUntil(client, [&]
+                            { return first.done; }));
+        CHECK(first.ok && loop.Events(fd) == EPOLLIN);
+        fake_mysql::SetBlockSend(false);
+        Shutdown(client, loop, serverFds);
+        printf("[PASS] blocked send resumes on EPOLLOUT\n");
+    }
+
+    // 启动时一条都没连上，客户端仍可用，由重连线程补上
+    void TestInitWithoutServer()
+    {
+        Loop loop;
+        AsyncSqlClient client;
+        fake_mysql::SetRefuse(true);
+        InitClient(client, loop, 2);
+        std::vector<int> serverFds;
+        CHECK(client.LiveConns() == 0);
+
+        fake_mysql::SetRefuse(false);
+        CHECK(loop.RunUntil(client, [&]
+                            { return client.LiveConns() == 2; }));
+        Shutdown(client, loop, serverFds);
+        printf("[PASS] init without server\n");
+    }
+}
+
+int main()
+{
+    signal(SIGPIPE, SIG_IGN);
+    TestErrorWithPending();
+    TestPendingMovesToLiveConn();
+    TestEofDuringQuery();
+    TestIdleEofAndRefusedReconnect();
+    TestPendingExpires();
+    TestBlockedSend();
+    TestInitWithoutServer();
+    return 0;
+}
+
+#else
+
+int main()
+{
+    printf("MySQL client has no non-blocking API, skipped\n");
+    return 77;
+}
+
+#endif
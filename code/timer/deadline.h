@@ -0,0 +1,63 @@
+//
+// 请求截止时间：由到达时间加处理预算得到，随请求经过工作线程排队、数据库通道、连接获取与查询执行，
+// 任一阶段发现已过期就放弃后续工作，并按阶段计数
+//
+#ifndef DEADLINE_H
+#define DEADLINE_H
+
+#include <chrono>
+#include <atomic>
+#include <algorithm>
+
+class Deadline
+{
+public:
+    typedef std::chrono::steady_clock Clock;
+
+    enum STAGE
+    {
+        WORKER_QUEUE = 0, // 在工作线程池排队时过期
+        DB_QUEUE,         // 在数据库通道排队时过期
+        DB_CONN,          // 等待数据库连接时过期
+        DB_QUERY,         // 拿到连接后、执行语句前过期
+        RESPONSE,         // 结果返回时已过期（仍然发送）
+        STAGE_NUM,
+    };
+
+    Deadline() : at_(Clock::time_point::max()) {} // 不限时
+    explicit Deadline(Clock::time_point at) : at_(at) {}
+
+    // budgetMs <= 0 表示不限时
+    static Deadline After(Clock::time_point start, int budgetMs)
+    {
+        return budgetMs > 0 ? Deadline(start + std::chrono::milliseconds(budgetMs)) : Deadline();
+    }
+
+    bool IsSet() const { return at_ != Clock::time_point::max(); }
+    bool Expired() const { return IsSet() && Clock::now() >= at_; }
+
+    // 剩余毫秒数，不超过 capMs；不限时返回 capMs
+    int RemainingMs(int capMs) const
+    {
+        if (!IsSet())
+        {
+            return capMs;
+        }
+        long long left = std::chrono::duration_cast<std::chrono::milliseconds>(at_ - Clock::now()).count();
+        return (int)std::max(0LL, std::min<long long>(left, capMs));
+    }
+
+    static void CountExpired(STAGE stage) { Counters_()[stage]++; }
+    static unsigned long long ExpiredCount(STAGE stage) { return Counters_()[stage]; }
+
+private:
+    static std::atomic<unsigned long long> *Counters_()
+    {
+        static std::atomic<unsigned long long> counters[STAGE_NUM] = {};
+        return counters;
+    }
+
+    Clock::time_point at_;
+};
+
+#endif
@@ -36,6 +36,7 @@ public:
     void tick();
     void pop();
     int GetNextTick();
+    size_t Size() const { return heap_.size(); }
 
 private:
     void del_(size_t i);                    // 删除
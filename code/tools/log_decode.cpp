@@ -0,0 +1,148 @@
+//
+// 把 LOG_FORMAT_BINARY 写出的二进制日志转成文本，输出与文本模式一致
+// 用法：log_decode file... （不带参数时读标准输入）
+//
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <vector>
+#include "../log/log_codec.h"
+
+namespace
+{
+    struct Format
+    {
+        std::string format;
+        std::string types;
+        int level = 1;
+        bool valid = false;
+    };
+
+    bool ReadN(FILE *fp, void *dst, size_t n)
+    {
+        return fread(dst, 1, n, fp) == n;
+    }
+
+    // 返回 false 表示文件损坏或截断
+    bool Decode(FILE *in, const char *name)
+    {
+        std::vector<Format> formats; //下标为格式 id，每遇到文件头清空（id 只在单次运行内有效）
+        std::vector<char> args;
+        char line[4096];
+        int type;
+        while ((type = fgetc(in)) != EOF)
+        {
+            if (type == 'H')
+            {
+                char magic[LogCodec::FILE_MAGIC_LEN];
+                if (!ReadN(in, magic, sizeof(magic)) || memcmp(magic, LogCodec::FILE_MAGIC, sizeof(magic)) != 0)
+                {
+                    fprintf(stderr, "%s: bad file header\n", name);
+                    return false;
+                }
+                formats.clear();
+            }
+            else if (type == 'F')
+            {
+                uint32_t id;
+                uint8_t level;
+                uint16_t fmtLen, typesLen;
+                if (!ReadN(in, &id, 4) || !ReadN(in, &level, 1) || !ReadN(in, &fmtLen, 2) || !ReadN(in, &typesLen, 2))
+                {
+                    break;
+                }
+                std::string fmt(fmtLen, '\0'), types(typesLen, '\0');
+                if (!ReadN(in, &fmt[0], fmtLen) || !ReadN(in, &types[0], typesLen))
+                {
+                    break;
+                }
+                if (id >= formats.size())
+                {
+                    formats.resize(id + 1);
+                }
+                formats[id].format = fmt;
+                formats[id].types = types;
+                formats[id].level = level;
+                formats[id].valid = true;
+            }
+            else if (type == 'E')
+            {
+                char header[LogCodec::EVENT_HEADER];
+                if (!ReadN(in, header, sizeof(header)))
+                {
+                    break;
+                }
+                uint32_t id, argLen;
+                int64_t ns;
+                LogCodec::GetEventHeader(header, id, argLen, ns);
+                args.resize(argLen);
+                if (argLen > 0 && !ReadN(in, args.data(), argLen))
+                {
+                    break;
+                }
+                if (id >= formats.size() || !formats[id].valid)
+                {
+                    fprintf(stderr, "%s: unknown format id %u\n", name, id);
+                    continue;
+                }
+                LogRegistry::Entry entry = {formats[id].format.c_str(), formats[id].types.c_str(), formats[id].level};
+                int n = LogCodec::FormatEvent(entry, ns, args.data(), argLen, line, sizeof(line));
+                fwrite(line, 1, n, stdout);
+            }
+            else if (type == 'T')
+            {
+                uint32_t len;
+                if (!ReadN(in, &len, 4))
+                {
+                    break;
+                }
+                std::string text(len, '\0');
+                if (len > 0 && !ReadN(in, &text[0], len))
+                {
+                    break;
+                }
+                fwrite(text.data(), 1, len, stdout);
+            }
+            else
+            {
+                fprintf(stderr, "%s: unknown record type 0x%02x at offset %ld\n", name, type, ftell(in) - 1);
+                return false;
+            }
+        }
+        if (ferror(in))
+        {
+            fprintf(stderr, "%s: read error\n", name);
+            return false;
+        }
+        if (type != EOF) //最后一条记录没写完整，进程异常退出时正常
+        {
+            fprintf(stderr, "%s: truncated record at end of file\n", name);
+        }
+        return true;
+    }
+}
+
+int main(int argc, char *argv[])
+{
+    if (argc < 2)
+    {
+        return Decode(stdin, "<stdin>") ? 0 : 1;
+    }
+    int ret = 0;
+    for (int i = 1; i < argc; i++)
+    {
+        FILE *in = fopen(argv[i], "rb");
+        if (in == nullptr)
+        {
+            perror(argv[i]);
+            ret = 1;
+            continue;
+        }
+        if (!Decode(in, argv[i]))
+        {
+            ret = 1;
+        }
+        fclose(in);
+    }
+    return ret;
+}